@@ -5,6 +5,8 @@
 
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
+
+#include <array>
 #include "python-lib/pimu.hpp"
 
 namespace py = pybind11;
@@ -51,9 +53,23 @@ PYBIND11_MODULE(pimu, m) {
         .value("LP_ACCEL_ODR_500HZ",   pimu::MPU9250::LpAccelOdr::LP_ACCEL_ODR_500HZ)
         .export_values();
 
+    // Shared I2C bus manager
+    py::class_<pimu::I2CBus> i2c_bus(m, "I2CBus");
+    py::enum_<pimu::I2CBus::Priority>(i2c_bus, "Priority")
+        .value("HIGH", pimu::I2CBus::HIGH)
+        .value("LOW", pimu::I2CBus::LOW)
+        .export_values();
+    i2c_bus
+        .def_static("get", &pimu::I2CBus::get, py::return_value_policy::reference)
+        .def("getPath", &pimu::I2CBus::getPath)
+        .def("getQueueDelay", &pimu::I2CBus::getQueueDelay)
+        .def("getTransactionCount", &pimu::I2CBus::getTransactionCount)
+        .def("getErrorCount", &pimu::I2CBus::getErrorCount)
+        .def("resetStats", &pimu::I2CBus::resetStats);
+
     // Class MPU9250
     py::class_<pimu::MPU9250>(m, "MPU9250")
-        .def(py::init<>())
+        .def(py::init<const std::string &, uint8_t>(), py::arg("bus") = "/dev/i2c-1", py::arg("address") = 0x68)
         .def("begin", &pimu::MPU9250::begin)
         .def("writeRegister", &pimu::MPU9250::writeRegister)
         .def("readRegisters", &pimu::MPU9250::readRegisters)
@@ -64,7 +80,11 @@ PYBIND11_MODULE(pimu, m) {
         .def("enableDataReadyInterrupt", &pimu::MPU9250::enableDataReadyInterrupt)
         .def("disableDataReadyInterrupt", &pimu::MPU9250::disableDataReadyInterrupt)
         .def("enableWakeOnMotion", &pimu::MPU9250::enableWakeOnMotion)
-        .def("readSensor", &pimu::MPU9250::readSensor)
+        .def("readSensor", static_cast<int (pimu::MPU9250::*)(bool)>(&pimu::MPU9250::readSensor), py::arg("force") = false)
+        .def("setFreshness", &pimu::MPU9250::setFreshness)
+        .def("getFrame", &pimu::MPU9250::getFrame)
+        .def("getBusReads", &pimu::MPU9250::getBusReads)
+        .def("getCacheHits", &pimu::MPU9250::getCacheHits)
         .def("getGyroX_rads", &pimu::MPU9250::getGyroX_rads)
         .def("getGyroY_rads", &pimu::MPU9250::getGyroY_rads)
         .def("getGyroZ_rads", &pimu::MPU9250::getGyroZ_rads)
@@ -74,7 +94,192 @@ PYBIND11_MODULE(pimu, m) {
         .def("getMagX_uT", &pimu::MPU9250::getMagX_uT)
         .def("getMagY_uT", &pimu::MPU9250::getMagY_uT)
         .def("getMagZ_uT", &pimu::MPU9250::getMagZ_uT)
-        .def("getTemperature_C", &pimu::MPU9250::getTemperature_C);
+        .def("getTemperature_C", &pimu::MPU9250::getTemperature_C)
+        .def("getBus", &pimu::MPU9250::getBus)
+        .def("getAddress", &pimu::MPU9250::getAddress)
+        .def("getI2CBus", &pimu::MPU9250::getI2CBus, py::return_value_policy::reference);
+
+    py::class_<pimu::Sensor>(m, "Sensor")
+        .def_readonly("x", &pimu::Sensor::x)
+        .def_readonly("y", &pimu::Sensor::y)
+        .def_readonly("z", &pimu::Sensor::z);
+
+    py::class_<pimu::SensorFrame>(m, "SensorFrame")
+        .def_readonly("timestamp_ns", &pimu::SensorFrame::timestamp_ns)
+        .def_readonly("seq", &pimu::SensorFrame::seq)
+        .def_readonly("ax", &pimu::SensorFrame::ax)
+        .def_readonly("ay", &pimu::SensorFrame::ay)
+        .def_readonly("az", &pimu::SensorFrame::az)
+        .def_readonly("temp", &pimu::SensorFrame::temp)
+        .def_readonly("gx", &pimu::SensorFrame::gx)
+        .def_readonly("gy", &pimu::SensorFrame::gy)
+        .def_readonly("gz", &pimu::SensorFrame::gz)
+        .def_readonly("hx", &pimu::SensorFrame::hx)
+        .def_readonly("hy", &pimu::SensorFrame::hy)
+        .def_readonly("hz", &pimu::SensorFrame::hz);
+
+    py::class_<pimu::MultiSensor>(m, "MultiSensor")
+        .def_readonly("gx", &pimu::MultiSensor::gx)
+        .def_readonly("gy", &pimu::MultiSensor::gy)
+        .def_readonly("gz", &pimu::MultiSensor::gz)
+        .def_readonly("ax", &pimu::MultiSensor::ax)
+        .def_readonly("ay", &pimu::MultiSensor::ay)
+        .def_readonly("az", &pimu::MultiSensor::az);
+
+    py::class_<pimu::ImuSample>(m, "ImuSample")
+        .def_readonly("seq", &pimu::ImuSample::seq)
+        .def_readonly("timestamp_ns", &pimu::ImuSample::timestamp_ns)
+        .def_readonly("gyro", &pimu::ImuSample::gyro)
+        .def_readonly("accel", &pimu::ImuSample::accel)
+        .def_readonly("linear_accel", &pimu::ImuSample::linear_accel)
+        .def_readonly("x_axis_angle", &pimu::ImuSample::x_axis_angle)
+        .def_readonly("y_axis_angle", &pimu::ImuSample::y_axis_angle);
+
+    // Class Spectrum
+    py::class_<pimu::SpectrumResult>(m, "SpectrumResult")
+        .def_readonly("peak_frequency", &pimu::SpectrumResult::peak_frequency)
+        .def_readonly("peak_amplitude", &pimu::SpectrumResult::peak_amplitude)
+        .def_property_readonly("band_energy", [](const pimu::SpectrumResult &r) {
+            return std::vector<float>(r.band_energy, r.band_energy + pimu::kSpectrumMaxBands);
+        })
+        .def_readonly("block", &pimu::SpectrumResult::block);
+
+    py::class_<pimu::Spectrum> spectrum(m, "Spectrum");
+    py::enum_<pimu::Spectrum::Channel>(spectrum, "Channel")
+        .value("GYRO_X", pimu::Spectrum::Channel::GYRO_X)
+        .value("GYRO_Y", pimu::Spectrum::Channel::GYRO_Y)
+        .value("GYRO_Z", pimu::Spectrum::Channel::GYRO_Z)
+        .value("ACCEL_X", pimu::Spectrum::Channel::ACCEL_X)
+        .value("ACCEL_Y", pimu::Spectrum::Channel::ACCEL_Y)
+        .value("ACCEL_Z", pimu::Spectrum::Channel::ACCEL_Z)
+        .export_values();
+    spectrum
+        .def(py::init<float, int, int>())
+        .def("setBands", &pimu::Spectrum::setBands)
+        .def("start", &pimu::Spectrum::start)
+        .def("stop", &pimu::Spectrum::stop)
+        .def("getResult", &pimu::Spectrum::getResult)
+        .def("getPeakFrequency", &pimu::Spectrum::getPeakFrequency)
+        .def("getBandEnergy", &pimu::Spectrum::getBandEnergy)
+        .def("getDroppedBlocks", &pimu::Spectrum::getDroppedBlocks);
+
+    // Class DeadReckoning
+    py::class_<pimu::NavState>(m, "NavState")
+        .def_readonly("position", &pimu::NavState::position)
+        .def_readonly("velocity", &pimu::NavState::velocity)
+        .def_readonly("attitude", &pimu::NavState::attitude)
+        .def_readonly("time", &pimu::NavState::time)
+        .def_readonly("zero_velocity_updates", &pimu::NavState::zero_velocity_updates)
+        .def_readonly("stationary", &pimu::NavState::stationary);
+
+    py::class_<pimu::DeadReckoning>(m, "DeadReckoning")
+        .def(py::init<>())
+        .def("setStationaryDetection", &pimu::DeadReckoning::setStationaryDetection)
+        .def("reset", &pimu::DeadReckoning::reset)
+        .def("getState", &pimu::DeadReckoning::getState);
+
+    // Sample broadcast
+    using Subscriber = pimu::Broadcast<pimu::ImuSample>::Subscriber;
+    py::class_<Subscriber>(m, "Subscriber")
+        .def("read", [](Subscriber &subscriber, size_t max_samples) {
+            std::vector<pimu::ImuSample> samples(max_samples);
+            samples.resize(subscriber.readBatch(samples.data(), max_samples));
+            return samples;
+        })
+        .def("wait", [](Subscriber &subscriber, size_t max_samples, int timeout_ms) {
+            std::vector<pimu::ImuSample> samples;
+            {
+                py::gil_scoped_release release;
+                samples.reserve(max_samples);
+                subscriber.waitDispatch([&](const pimu::ImuSample &sample) { samples.push_back(sample); }, max_samples, timeout_ms);
+            }
+            return samples;
+        }, py::arg("max_samples"), py::arg("timeout_ms") = -1)
+        .def("available", &Subscriber::available)
+        .def("getOverflowCount", &Subscriber::getOverflowCount);
+
+    // Shared memory reader, for processes that don't own the sensor
+    using SharedSampleReader = pimu::SharedRingReader<pimu::ImuSample>;
+    py::class_<SharedSampleReader>(m, "SharedSampleReader")
+        .def(py::init<const std::string &>())
+        .def("read", [](SharedSampleReader &reader, size_t max_samples) {
+            std::vector<pimu::ImuSample> samples(max_samples);
+            samples.resize(reader.readBatch(samples.data(), max_samples));
+            return samples;
+        })
+        .def("readLatest", [](SharedSampleReader &reader) -> py::object {
+            pimu::ImuSample sample;
+            if (!reader.readLatest(sample)) return py::none();
+            return py::cast(sample);
+        })
+        .def("available", &SharedSampleReader::available)
+        .def("getOverflowCount", &SharedSampleReader::getOverflowCount)
+        .def("getSampleRate", &SharedSampleReader::getSampleRate);
+
+    // Binary logs
+    py::class_<pimu::BinaryLogInfo>(m, "BinaryLogInfo")
+        .def_readonly("sample_rate_hz", &pimu::BinaryLogInfo::sample_rate_hz)
+        .def_property_readonly("scale", [](const pimu::BinaryLogInfo &info) {
+            return std::vector<float>(info.scale, info.scale + pimu::kLogChannels);
+        })
+        .def_property_readonly("offset", [](const pimu::BinaryLogInfo &info) {
+            return std::vector<float>(info.offset, info.offset + pimu::kLogChannels);
+        })
+        .def_readonly("gyro_bias", &pimu::BinaryLogInfo::gyro_bias)
+        .def_readonly("accel_bias", &pimu::BinaryLogInfo::accel_bias);
+
+    py::class_<pimu::BinaryLogRecord>(m, "BinaryLogRecord")
+        .def_readonly("timestamp_ns", &pimu::BinaryLogRecord::timestamp_ns)
+        .def_readonly("seq", &pimu::BinaryLogRecord::seq)
+        .def_property_readonly("raw", [](const pimu::BinaryLogRecord &record) {
+            return std::vector<int16_t>(record.raw, record.raw + pimu::kLogChannels);
+        });
+
+    py::class_<pimu::BinaryLogReader>(m, "BinaryLogReader")
+        .def(py::init<const std::string &>())
+        .def("getInfo", [](pimu::BinaryLogReader &reader) { return reader.getHeader().info; })
+        .def("getChannelNames", [](pimu::BinaryLogReader &reader) {
+            std::vector<std::string> names;
+            for (int i = 0; i < pimu::kLogChannels; i++) names.push_back(reader.getHeader().channel_names[i]);
+            return names;
+        })
+        .def("getStartTime", [](pimu::BinaryLogReader &reader) { return reader.getHeader().start_time_ns; })
+        .def("getRecordCount", &pimu::BinaryLogReader::getRecordCount)
+        .def("getRecord", &pimu::BinaryLogReader::getRecord, py::return_value_policy::copy)
+        .def("getValue", &pimu::BinaryLogReader::getValue);
+
+    // Realtime options
+    py::class_<pimu::RealtimeOptions>(m, "RealtimeOptions")
+        .def(py::init<>())
+        .def_readwrite("priority", &pimu::RealtimeOptions::priority)
+        .def_readwrite("cpu", &pimu::RealtimeOptions::cpu)
+        .def_readwrite("lock_memory", &pimu::RealtimeOptions::lock_memory)
+        .def_readwrite("prefault_stack_bytes", &pimu::RealtimeOptions::prefault_stack_bytes);
+
+    py::class_<pimu::JitterReport>(m, "JitterReport")
+        .def_readonly("samples", &pimu::JitterReport::samples)
+        .def_readonly("mean_us", &pimu::JitterReport::mean_us)
+        .def_readonly("std_us", &pimu::JitterReport::std_us)
+        .def_readonly("min_us", &pimu::JitterReport::min_us)
+        .def_readonly("max_us", &pimu::JitterReport::max_us);
+
+    // Loop instrumentation
+    py::class_<pimu::LatencyStats>(m, "LatencyStats")
+        .def_readonly("count", &pimu::LatencyStats::count)
+        .def_readonly("p50_ns", &pimu::LatencyStats::p50_ns)
+        .def_readonly("p99_ns", &pimu::LatencyStats::p99_ns)
+        .def_readonly("max_ns", &pimu::LatencyStats::max_ns);
+
+    py::class_<pimu::LoopProfiler> loop_profiler(m, "LoopProfiler");
+    py::enum_<pimu::LoopProfiler::Stage>(loop_profiler, "Stage")
+        .value("READ", pimu::LoopProfiler::READ)
+        .value("FILTER", pimu::LoopProfiler::FILTER)
+        .value("ANGLES", pimu::LoopProfiler::ANGLES)
+        .value("PUBLISH", pimu::LoopProfiler::PUBLISH)
+        .value("CONSUMERS", pimu::LoopProfiler::CONSUMERS)
+        .value("UPDATE", pimu::LoopProfiler::UPDATE)
+        .value("WAKEUP", pimu::LoopProfiler::WAKEUP)
+        .export_values();
 
     // Class Imu
     py::class_<pimu::Imu>(m, "Imu")
@@ -83,9 +288,134 @@ PYBIND11_MODULE(pimu, m) {
         .def("calibrateGyro", &pimu::Imu::calibrateGyro)
         .def("calibrateAccel", &pimu::Imu::calibrateAccel)
         .def("read", &pimu::Imu::read)
+        .def("readSample", &pimu::Imu::readSample)
         .def("print", &pimu::Imu::print)
         .def("setGyroFilters", &pimu::Imu::setGyroFilters)
+        .def("setGyroSpikeFilter", &pimu::Imu::setGyroSpikeFilter,
+             py::arg("window_size"), py::arg("num_deviations"), py::arg("min_deviation") = 0.0f)
+        .def("getGyroRejectedSamples", &pimu::Imu::getGyroRejectedSamples)
+        .def("setGyroNotchFilter", &pimu::Imu::setGyroNotchFilter)
+        .def("setGyroNotchFrequency", &pimu::Imu::setGyroNotchFrequency)
+        .def("getGyroNotchFrequencies", &pimu::Imu::getGyroNotchFrequencies)
         .def("startUpdateThread", &pimu::Imu::startUpdateThread)
+        .def("stopUpdateThread", &pimu::Imu::stopUpdateThread, py::call_guard<py::gil_scoped_release>())
+        .def("isUpdateThreadRunning", &pimu::Imu::isUpdateThreadRunning)
+        .def("isDriven", &pimu::Imu::isDriven)
+        .def("setUpdateRate", &pimu::Imu::setUpdateRate)
+        .def("setRealtimeOptions", &pimu::Imu::setRealtimeOptions)
+        .def("getJitterReport", &pimu::Imu::getJitterReport)
+        .def("getUpdateOverruns", &pimu::Imu::getUpdateOverruns)
+        .def("getLatencyStats", &pimu::Imu::getLatencyStats)
+        .def("resetLatencyStats", &pimu::Imu::resetLatencyStats)
+        .def("printLatencyStats", &pimu::Imu::printLatencyStats)
+        .def("resetJitterReport", &pimu::Imu::resetJitterReport)
+        .def("attachSpectrum", &pimu::Imu::attachSpectrum, py::keep_alive<1, 2>())
+        .def("attachDeadReckoning", &pimu::Imu::attachDeadReckoning, py::keep_alive<1, 2>())
         .def("getXAxisAngle", &pimu::Imu::getXAxisAngle)
-        .def("getYAxisAngle", &pimu::Imu::getYAxisAngle);
+        .def("getYAxisAngle", &pimu::Imu::getYAxisAngle)
+        .def("getLinearAccel", &pimu::Imu::getLinearAccel)
+        .def("getLatestSample", &pimu::Imu::getLatestSample)
+        .def("enableSampleRing", &pimu::Imu::enableSampleRing)
+        .def("popSamples", [](pimu::Imu &imu, size_t max_samples) {
+            std::vector<pimu::ImuSample> samples(max_samples);
+            samples.resize(imu.popSamples(samples.data(), max_samples));
+            return samples;
+        })
+        .def("getSampleOverflows", &pimu::Imu::getSampleOverflows)
+        .def("enableBroadcast", &pimu::Imu::enableBroadcast)
+        .def("subscribe", &pimu::Imu::subscribe, py::keep_alive<0, 1>())
+        .def("enableSharedRing", &pimu::Imu::enableSharedRing)
+        .def("getLogInfo", &pimu::Imu::getLogInfo)
+        .def("enableBinaryLog", &pimu::Imu::enableBinaryLog)
+        .def("closeBinaryLog", &pimu::Imu::closeBinaryLog);
+
+    // Class ImuGroup
+    py::class_<pimu::ImuGroup>(m, "ImuGroup")
+        .def(py::init<>())
+        .def("add", &pimu::ImuGroup::add, py::keep_alive<1, 2>())
+        .def("start", &pimu::ImuGroup::start)
+        .def("stop", &pimu::ImuGroup::stop, py::call_guard<py::gil_scoped_release>())
+        .def("isRunning", &pimu::ImuGroup::isRunning)
+        .def("setRealtimeOptions", &pimu::ImuGroup::setRealtimeOptions)
+        .def("setBusCpu", &pimu::ImuGroup::setBusCpu)
+        .def("getBusCount", &pimu::ImuGroup::getBusCount)
+        .def("getOverruns", &pimu::ImuGroup::getOverruns);
+
+    // Class ImuFrame
+    py::class_<pimu::ImuFrame>(m, "ImuFrame")
+        .def_readonly("seq", &pimu::ImuFrame::seq)
+        .def_readonly("timestamp_ns", &pimu::ImuFrame::timestamp_ns)
+        .def_property_readonly("samples", [](const pimu::ImuFrame &frame) {
+            return std::vector<pimu::ImuSample>(frame.samples, frame.samples + frame.num_imus);
+        })
+        .def_property_readonly("read_offset_ns", [](const pimu::ImuFrame &frame) {
+            return std::vector<int64_t>(frame.read_offset_ns, frame.read_offset_ns + frame.num_imus);
+        });
+
+    using FrameSubscriber = pimu::Broadcast<pimu::ImuFrame>::Subscriber;
+    py::class_<FrameSubscriber>(m, "FrameSubscriber")
+        .def("read", [](FrameSubscriber &subscriber, size_t max_frames) {
+            std::vector<pimu::ImuFrame> frames(max_frames);
+            frames.resize(subscriber.readBatch(frames.data(), max_frames));
+            return frames;
+        })
+        .def("wait", [](FrameSubscriber &subscriber, size_t max_frames, int timeout_ms) {
+            std::vector<pimu::ImuFrame> frames;
+            {
+                py::gil_scoped_release release;
+                frames.reserve(max_frames);
+                subscriber.waitDispatch([&](const pimu::ImuFrame &frame) { frames.push_back(frame); }, max_frames, timeout_ms);
+            }
+            return frames;
+        }, py::arg("max_frames"), py::arg("timeout_ms") = -1)
+        .def("available", &FrameSubscriber::available)
+        .def("getOverflowCount", &FrameSubscriber::getOverflowCount);
+
+    // Class ImuArray
+    py::class_<pimu::ImuArray>(m, "ImuArray")
+        .def(py::init<size_t>(), py::arg("frame_capacity") = 256)
+        .def("add", &pimu::ImuArray::add, py::keep_alive<1, 2>())
+        .def("start", &pimu::ImuArray::start)
+        .def("stop", &pimu::ImuArray::stop, py::call_guard<py::gil_scoped_release>())
+        .def("isRunning", &pimu::ImuArray::isRunning)
+        .def("setRealtimeOptions", &pimu::ImuArray::setRealtimeOptions)
+        .def("getLatestFrame", &pimu::ImuArray::getLatestFrame)
+        .def("subscribe", &pimu::ImuArray::subscribe, py::keep_alive<0, 1>())
+        .def("getOverruns", &pimu::ImuArray::getOverruns);
+
+    // Virtual IMU corrections, bias and scale are set as (x, y, z), rotation as 3 rows of 3
+    py::class_<pimu::SensorCorrection>(m, "SensorCorrection")
+        .def(py::init<>())
+        .def_property("bias", [](const pimu::SensorCorrection &correction) { return correction.bias; },
+                      [](pimu::SensorCorrection &correction, std::array<float, 3> bias) { correction.bias = {bias[0], bias[1], bias[2]}; })
+        .def_property("scale", [](const pimu::SensorCorrection &correction) { return correction.scale; },
+                      [](pimu::SensorCorrection &correction, std::array<float, 3> scale) { correction.scale = {scale[0], scale[1], scale[2]}; })
+        .def_property("rotation",
+            [](const pimu::SensorCorrection &correction) {
+                std::array<std::array<float, 3>, 3> rotation;
+                for (int i = 0; i < 3; i++) for (int j = 0; j < 3; j++) rotation[i][j] = correction.rotation[i][j];
+                return rotation;
+            },
+            [](pimu::SensorCorrection &correction, std::array<std::array<float, 3>, 3> rotation) {
+                for (int i = 0; i < 3; i++) for (int j = 0; j < 3; j++) correction.rotation[i][j] = rotation[i][j];
+            });
+
+    py::class_<pimu::ImuCorrection>(m, "ImuCorrection")
+        .def(py::init<>())
+        .def_readwrite("gyro", &pimu::ImuCorrection::gyro)
+        .def_readwrite("accel", &pimu::ImuCorrection::accel);
+
+    // Class VirtualImu
+    py::class_<pimu::VirtualImu>(m, "VirtualImu")
+        .def(py::init<>())
+        .def("add", &pimu::VirtualImu::add, py::arg("imu"), py::arg("weight") = 1.0f, py::keep_alive<1, 2>())
+        .def("setCorrection", &pimu::VirtualImu::setCorrection)
+        .def("setWeight", &pimu::VirtualImu::setWeight)
+        .def("setOutlierRejection", &pimu::VirtualImu::setOutlierRejection, py::arg("num_deviations"), py::arg("min_deviation") = 0.0f)
+        .def("getImuCount", &pimu::VirtualImu::getImuCount)
+        .def("getRejectedReadings", &pimu::VirtualImu::getRejectedReadings)
+        .def("read", &pimu::VirtualImu::read)
+        .def("fuse", &pimu::VirtualImu::fuse)
+        .def("print", &pimu::VirtualImu::print);
+
 }
@@ -2,6 +2,7 @@
 #include "LowPass.hpp"
 #include "MPU9250.hpp"
 #include "type.hpp"
+#include "PeriodicTimer.hpp"
 #include "LinearRegression.hpp"
 #endif
 
@@ -25,6 +26,11 @@ public:
     float getYBias();
     float getZBias();
 
+    Sensor getSpecificForce(const SensorFrame &frame);
+    Sensor toReading(const Sensor &specific_force);
+    Sensor removeGravity(const Sensor &specific_force, float x_axis_angle, float y_axis_angle);
+    Sensor getGravityReference();
+
 private:
     MPU9250 &module_;
 
@@ -38,6 +44,9 @@ private:
     float y_bias_ = 0.0f;
     float z_bias_ = 0.0f;
 
+    // gravity measured during calibration [G], default is the sensor lying flat (module frame has Z pointing down)
+    Sensor gravity_ = {0.0f, 0.0f, -1.0f};
+
     const float kG_ = 9.807f;
 };
 
@@ -50,17 +59,20 @@ int Accel::calibrate(int duration_seconds) {
     x_bias_ = y_bias_ = z_bias_ = 0;
 
     // take samples and find bias
-    auto start = std::chrono::high_resolution_clock::now();
-    auto end = start + std::chrono::seconds(duration_seconds);
-    while (std::chrono::high_resolution_clock::now() < end) {
+    // fixed rate sampling, the number of samples does not depend on how long each read takes
+    const int kRateHz = 50;
+    PeriodicTimer timer;
+    timer.start(kRateHz);
+    for (int i = 0; i < duration_seconds * kRateHz; i++) {
         calibration_num_samples_++;
 
         module_.readSensor();
-        ax_sum += module_.getAccelX_mss() / kG_;
-        ay_sum += module_.getAccelY_mss() / kG_;
-        az_sum += module_.getAccelZ_mss() / kG_;
+        Sensor accel = module_.getAccel_mss(module_.getFrame());
+        ax_sum += accel.x / kG_;
+        ay_sum += accel.y / kG_;
+        az_sum += accel.z / kG_;
 
-        delay(20);
+        timer.wait();
     }
 
     // set offsets
@@ -68,6 +80,14 @@ int Accel::calibrate(int duration_seconds) {
     y_bias_ = ay_sum / calibration_num_samples_;
     z_bias_ = az_sum / calibration_num_samples_;
 
+    // the mean direction is taken as gravity (1 G), what is left is the sensor offset
+    float norm = sqrt(x_bias_ * x_bias_ + y_bias_ * y_bias_ + z_bias_ * z_bias_);
+    if (norm > 0.5f) {
+        gravity_.x = x_bias_ / norm;
+        gravity_.y = y_bias_ / norm;
+        gravity_.z = z_bias_ / norm;
+    }
+
     return 1;
 }
 
@@ -75,11 +95,12 @@ int Accel::calibrate(int duration_seconds) {
 Sensor Accel::read() {
     Sensor return_data;
     module_.readSensor();
+    Sensor accel = module_.getAccel_mss(module_.getFrame());
 
     // convert m/s/s to kG_ minus offset
-    return_data.x = round((module_.getAccelX_mss() / kG_) - x_bias_, 2);
-    return_data.y = round((module_.getAccelY_mss() / kG_) - y_bias_, 2);
-    return_data.z = round((module_.getAccelZ_mss() / kG_) - z_bias_, 2);
+    return_data.x = round((accel.x / kG_) - x_bias_, 2);
+    return_data.y = round((accel.y / kG_) - y_bias_, 2);
+    return_data.z = round((accel.z / kG_) - z_bias_, 2);
 
     return return_data;
 }
@@ -113,4 +134,52 @@ float Accel::getYBias() { return y_bias_; }
 /* returns Z axis offset, 0 by default, only changes after Accel::calibrate() */
 float Accel::getZBias() { return z_bias_; }
 
+/* 
+    returns the specific force of a frame read by the module (e.g. Gyro::getLastFrame()), gravity included [G]
+    only the sensor offset is removed (calibration mean minus gravity), no bus read is done
+*/
+Sensor Accel::getSpecificForce(const SensorFrame &frame) {
+    Sensor accel = module_.getAccel_mss(frame);
+    Sensor force;
+    bool calibrated = calibration_num_samples_ > 0;
+    force.x = accel.x / kG_ - (calibrated ? x_bias_ - gravity_.x : 0.0f);
+    force.y = accel.y / kG_ - (calibrated ? y_bias_ - gravity_.y : 0.0f);
+    force.z = accel.z / kG_ - (calibrated ? z_bias_ - gravity_.z : 0.0f);
+    return force;
+}
+
+/* turns a specific force back into what Accel::read() returns for the same frame (calibration mean removed) [G] */
+Sensor Accel::toReading(const Sensor &specific_force) {
+    bool calibrated = calibration_num_samples_ > 0;
+    Sensor reading;
+    reading.x = round(specific_force.x - (calibrated ? gravity_.x : 0.0f), 2);
+    reading.y = round(specific_force.y - (calibrated ? gravity_.y : 0.0f), 2);
+    reading.z = round(specific_force.z - (calibrated ? gravity_.z : 0.0f), 2);
+    return reading;
+}
+
+/* 
+    returns the linear acceleration [G], subtracts gravity rotated by the attitude [rad]
+    the attitude is relative to the calibration pose: rotation about X (x_axis_angle) then about the new Y (y_axis_angle)
+*/
+Sensor Accel::removeGravity(const Sensor &specific_force, float x_axis_angle, float y_axis_angle) {
+    float cx = cos(x_axis_angle), sx = sin(x_axis_angle);
+    float cy = cos(y_axis_angle), sy = sin(y_axis_angle);
+
+    // gravity in body axes = Ry(-y) * Rx(-x) * gravity reference
+    float gy = cx * gravity_.y + sx * gravity_.z;
+    float gz = -sx * gravity_.y + cx * gravity_.z;
+    float gx = cy * gravity_.x - sy * gz;
+    gz = sy * gravity_.x + cy * gz;
+
+    Sensor linear;
+    linear.x = specific_force.x - gx;
+    linear.y = specific_force.y - gy;
+    linear.z = specific_force.z - gz;
+    return linear;
+}
+
+/* returns the gravity direction measured by Accel::calibrate() [G], (0, 0, -1) by default */
+Sensor Accel::getGravityReference() { return gravity_; }
+
 } // namespace pimu
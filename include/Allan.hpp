@@ -0,0 +1,233 @@
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace pimu {
+
+/* overlapping allan deviation of every channel for one cluster size */
+struct AllanPoint
+{
+    /* cluster time [s] */
+    double tau;
+
+    /* samples per cluster */
+    size_t cluster_size;
+
+    /* number of overlapping cluster pairs averaged */
+    size_t num_terms;
+
+    /* allan deviation per channel [channel unit] */
+    std::vector<double> deviation;
+};
+
+/*
+    overlapping allan variance over long recordings of interleaved float samples
+    cluster sizes are octave spaced (1, 2, 4, ...), each cluster size is an independent task
+    and tasks are spread over a pool of threads, all channels of a task share one pass over the data
+*/
+class Allan {
+public:
+    explicit Allan(double sample_rate_hz);
+
+    void setThreads(int num_threads);
+    std::vector<AllanPoint> compute(const float *data, size_t num_samples, int num_channels);
+    std::vector<AllanPoint> computeFile(const std::string &file_name, int num_channels);
+
+    static double angleRandomWalk(const std::vector<AllanPoint> &points, int channel);
+    static double biasInstability(const std::vector<AllanPoint> &points, int channel);
+    static void print(const std::vector<AllanPoint> &points);
+
+private:
+    double sample_rate_;
+    int num_threads_;
+
+    static void computePoint(const float *data, int num_channels, AllanPoint &point);
+    static void checkChannel(const std::vector<AllanPoint> &points, int channel);
+};
+
+/* sample_rate_hz: rate the samples were recorded at */
+Allan::Allan(double sample_rate_hz) : sample_rate_(sample_rate_hz) {
+    num_threads_ = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+/* sets the number of worker threads, by default one per core */
+void Allan::setThreads(int num_threads) {
+    num_threads_ = std::max(1, num_threads);
+}
+
+/* computes the allan deviation of interleaved samples (data[sample * num_channels + channel]) */
+std::vector<AllanPoint> Allan::compute(const float *data, size_t num_samples, int num_channels) {
+    std::vector<AllanPoint> points;
+    if (num_channels <= 0 || num_samples < 3) {
+        std::cerr << "Error: Se necesitan al menos 3 muestras para calcular la varianza de Allan.\n";
+        return points;
+    }
+
+    // octave spaced cluster sizes, at least one pair of clusters is required
+    for (size_t m = 1; 2 * m < num_samples; m *= 2) {
+        AllanPoint point;
+        point.tau = m / sample_rate_;
+        point.cluster_size = m;
+        point.num_terms = num_samples - 2 * m + 1;
+        point.deviation.assign(num_channels, 0.0);
+        points.push_back(point);
+    }
+
+    // the largest clusters are the same cost as the smallest ones (one pass each), a shared counter balances them
+    std::atomic<size_t> next_point{0};
+    auto worker = [&]() {
+        size_t i;
+        while ((i = next_point.fetch_add(1)) < points.size()) {
+            computePoint(data, num_channels, points[i]);
+        }
+    };
+
+    int num_threads = std::min(num_threads_, static_cast<int>(points.size()));
+    std::vector<std::thread> threads;
+    for (int t = 1; t < num_threads; t++) threads.emplace_back(worker);
+    worker();
+    for (auto &thread : threads) thread.join();
+
+    return points;
+}
+
+/* computes the allan deviation of a raw recording (little endian float32, interleaved channels) mapped in memory */
+std::vector<AllanPoint> Allan::computeFile(const std::string &file_name, int num_channels) {
+    std::vector<AllanPoint> points;
+    if (num_channels <= 0) {
+        std::cerr << "Error: El numero de canales debe ser positivo.\n";
+        return points;
+    }
+
+    int fd = open(file_name.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Error: No se pudo abrir el archivo " << file_name << "\n";
+        return points;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) < 0 || info.st_size == 0) {
+        std::cerr << "Error: No se pudo leer el tamaño del archivo " << file_name << "\n";
+        close(fd);
+        return points;
+    }
+
+    size_t size = static_cast<size_t>(info.st_size);
+    void *map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        std::cerr << "Error: No se pudo mapear el archivo " << file_name << "\n";
+        return points;
+    }
+
+    // every task streams through the whole file
+    madvise(map, size, MADV_SEQUENTIAL);
+
+    size_t num_samples = size / (sizeof(float) * num_channels);
+    points = compute(static_cast<const float *>(map), num_samples, num_channels);
+
+    munmap(map, size);
+    return points;
+}
+
+/*
+    returns the angle (or velocity) random walk of a channel [channel unit * sqrt(s)],
+    read from the point where the log-log slope is closest to -1/2, segments with a zero deviation are skipped
+*/
+double Allan::angleRandomWalk(const std::vector<AllanPoint> &points, int channel) {
+    checkChannel(points, channel);
+    if (points.size() < 2) return 0.0;
+
+    size_t best = 0;
+    double best_error = 1e9;
+    for (size_t i = 0; i + 1 < points.size(); i++) {
+        // a constant channel (or a quantized one at short tau) has no slope
+        if (points[i].deviation[channel] <= 0.0 || points[i + 1].deviation[channel] <= 0.0) continue;
+        double slope = std::log(points[i + 1].deviation[channel] / points[i].deviation[channel]) /
+                       std::log(points[i + 1].tau / points[i].tau);
+        if (std::abs(slope + 0.5) < best_error) {
+            best_error = std::abs(slope + 0.5);
+            best = i;
+        }
+    }
+    if (best_error == 1e9) return 0.0;
+    return points[best].deviation[channel] * std::sqrt(points[best].tau);
+}
+
+/* returns the bias instability of a channel, minimum of the curve over sqrt(2 ln2 / pi) [channel unit] */
+double Allan::biasInstability(const std::vector<AllanPoint> &points, int channel) {
+    checkChannel(points, channel);
+    double minimum = 0.0;
+    for (size_t i = 0; i < points.size(); i++) {
+        if (i == 0 || points[i].deviation[channel] < minimum) minimum = points[i].deviation[channel];
+    }
+    return minimum / 0.664;
+}
+
+/* prints tau and the deviation of every channel, one cluster size per line */
+void Allan::print(const std::vector<AllanPoint> &points) {
+    for (const AllanPoint &point : points) {
+        std::cout << point.tau;
+        for (double deviation : point.deviation) std::cout << ", " << deviation;
+        std::cout << "\n";
+    }
+}
+
+/* one pass over the data for a single cluster size, two sliding cluster sums per channel */
+void Allan::computePoint(const float *data, int num_channels, AllanPoint &point) {
+    size_t m = point.cluster_size;
+    std::vector<double> first(num_channels, 0.0), second(num_channels, 0.0), accumulator(num_channels, 0.0);
+
+    for (size_t i = 0; i < m; i++) {
+        for (int c = 0; c < num_channels; c++) {
+            first[c] += data[i * num_channels + c];
+            second[c] += data[(i + m) * num_channels + c];
+        }
+    }
+
+    size_t terms = point.num_terms;
+    double *__restrict sum1 = first.data();
+    double *__restrict sum2 = second.data();
+    double *__restrict acc = accumulator.data();
+    for (size_t k = 0; k + 1 < terms; k++) {
+        const float *x0 = data + k * num_channels;
+        const float *x1 = x0 + m * num_channels;
+        const float *x2 = x1 + m * num_channels;
+        for (int c = 0; c < num_channels; c++) {
+            double difference = sum2[c] - sum1[c];
+            acc[c] += difference * difference;
+            // slide both clusters one sample
+            sum1[c] += static_cast<double>(x1[c]) - x0[c];
+            sum2[c] += static_cast<double>(x2[c]) - x1[c];
+        }
+    }
+    for (int c = 0; c < num_channels; c++) {
+        double difference = sum2[c] - sum1[c];
+        acc[c] += difference * difference;
+    }
+
+    // avar = sum((avg2 - avg1)^2) / (2 * terms), with avg = sum / m
+    for (int c = 0; c < num_channels; c++) {
+        point.deviation[c] = std::sqrt(accumulator[c] / (2.0 * static_cast<double>(m) * m * terms));
+    }
+}
+
+/* throws if channel is not one of the channels of the points */
+void Allan::checkChannel(const std::vector<AllanPoint> &points, int channel) {
+    if (channel < 0 || (!points.empty() && static_cast<size_t>(channel) >= points[0].deviation.size())) {
+        throw std::invalid_argument("The channel is out of range.");
+    }
+}
+
+} // namespace pimu
@@ -0,0 +1,235 @@
+#ifdef VSCODE_INTELLISENSE_SUPPORT
+#include "Imu.hpp"
+#include "EventLoop.hpp"
+#include "PeriodicTimer.hpp"
+#include "type.hpp"
+#endif
+
+/* coroutine interface, only available when compiling as C++20 (or newer) with coroutine support */
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+
+#include <coroutine>
+#include <exception>
+#include <stdexcept>
+#include <vector>
+
+namespace pimu {
+
+/* eager fire and forget coroutine, the frame is destroyed when the body ends */
+struct Task
+{
+    struct promise_type
+    {
+        Task get_return_object() { return Task(); }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+/*
+    samples an Imu from an EventLoop instead of a dedicated thread
+    a timerfd on the loop runs Imu::update() at the given rate and resumes the coroutines waiting for samples
+    on the same thread, so many IMUs and other file descriptors can share one thread with no handoff
+    obs: the Imu is claimed (Imu::claimDriver()) for the life of the AsyncImu, coroutines still waiting when the AsyncImu
+    is destroyed are never resumed
+*/
+class AsyncImu {
+private:
+    // intrusive list node, lives inside the awaiter (so inside the coroutine frame), nothing is allocated
+    struct Waiter
+    {
+        Waiter *next = nullptr;
+        std::coroutine_handle<> handle;
+        void *owner = nullptr;  // awaiter or stream the waiter belongs to
+        bool (*deliver)(Waiter *waiter, const ImuSample &sample) = nullptr; // true when it should resume
+    };
+
+public:
+    class SampleAwaiter;
+    class BatchStream;
+
+    AsyncImu(EventLoop &loop, Imu &imu, float rate_hz);
+    ~AsyncImu();
+
+    SampleAwaiter nextSample();
+    BatchStream batches(size_t batch_size);
+    uint64_t getOverruns();
+
+private:
+    EventLoop &loop_;
+    Imu &imu_;
+    PeriodicTimer timer_;
+    Waiter *waiters_ = nullptr;
+
+    void enqueue(Waiter *waiter);
+    static void onTimer(void *context, uint32_t events);
+};
+
+/* co_await imu.nextSample() suspends until the next update and returns its sample */
+class AsyncImu::SampleAwaiter {
+public:
+    explicit SampleAwaiter(AsyncImu *imu) : imu_(imu) {}
+
+    bool await_ready() { return false; }
+    void await_suspend(std::coroutine_handle<> handle);
+    ImuSample await_resume() { return sample_; }
+
+private:
+    AsyncImu *imu_;
+    Waiter waiter_;
+    ImuSample sample_;
+
+    static bool deliver(Waiter *waiter, const ImuSample &sample);
+};
+
+/*
+    asynchronous stream of sample batches, co_await stream.next() returns the next batch_size consecutive samples
+    the batch buffer is allocated once and reused, it is valid until the following next()
+*/
+class AsyncImu::BatchStream {
+public:
+    class Awaiter;
+
+    BatchStream(AsyncImu *imu, size_t batch_size);
+
+    Awaiter next();
+
+private:
+    AsyncImu *imu_;
+    std::vector<ImuSample> batch_;
+    size_t count_ = 0;
+    Waiter waiter_;
+
+    static bool deliver(Waiter *waiter, const ImuSample &sample);
+};
+
+class AsyncImu::BatchStream::Awaiter {
+public:
+    explicit Awaiter(BatchStream *stream) : stream_(stream) {}
+
+    bool await_ready() { return false; }
+    void await_suspend(std::coroutine_handle<> handle);
+    const std::vector<ImuSample> &await_resume() { return stream_->batch_; }
+
+private:
+    BatchStream *stream_;
+};
+
+/* Constructor: registers a timer of rate_hz on the loop, sampling starts when the loop runs */
+AsyncImu::AsyncImu(EventLoop &loop, Imu &imu, float rate_hz) : loop_(loop), imu_(imu) {
+    if (imu_.claimDriver(rate_hz) < 0) {
+        throw std::logic_error("The Imu is already driven by its update thread or another loop.");
+    }
+    timer_.start(rate_hz);
+    if (loop_.add(timer_.getFd(), EPOLLIN, &AsyncImu::onTimer, this) < 0) {
+        imu_.releaseDriver();
+        throw std::runtime_error("Failed to register the Imu timer in the event loop.");
+    }
+}
+
+/* Destructor, stops sampling */
+AsyncImu::~AsyncImu() {
+    loop_.remove(timer_.getFd());
+    imu_.releaseDriver();
+}
+
+/* returns an awaitable for the next sample */
+AsyncImu::SampleAwaiter AsyncImu::nextSample() {
+    return SampleAwaiter(this);
+}
+
+/* returns a stream of batch_size sample batches */
+AsyncImu::BatchStream AsyncImu::batches(size_t batch_size) {
+    return BatchStream(this, batch_size);
+}
+
+/* returns the number of periods skipped because the loop was busy */
+uint64_t AsyncImu::getOverruns() {
+    return timer_.getOverruns();
+}
+
+/* adds a waiter for the next sample, loop thread only */
+void AsyncImu::enqueue(Waiter *waiter) {
+    waiter->next = waiters_;
+    waiters_ = waiter;
+}
+
+/* one period: updates the Imu and hands the sample to every waiter */
+void AsyncImu::onTimer(void *context, uint32_t events) {
+    (void)events;
+    AsyncImu *self = static_cast<AsyncImu *>(context);
+    if (self->timer_.acknowledge() <= 0) return;
+
+    self->imu_.update();
+    ImuSample sample = self->imu_.getLatestSample();
+
+    // waiters that are done are resumed after the list is rebuilt, a resumed coroutine may wait again
+    Waiter *pending = self->waiters_;
+    Waiter *ready = nullptr;
+    self->waiters_ = nullptr;
+    while (pending != nullptr) {
+        Waiter *waiter = pending;
+        pending = waiter->next;
+        if (waiter->deliver(waiter, sample)) {
+            waiter->next = ready;
+            ready = waiter;
+        } else {
+            self->enqueue(waiter);
+        }
+    }
+    while (ready != nullptr) {
+        Waiter *waiter = ready;
+        ready = waiter->next;
+        waiter->handle.resume(); // may destroy the waiter
+    }
+}
+
+/* parks the coroutine until the next sample */
+void AsyncImu::SampleAwaiter::await_suspend(std::coroutine_handle<> handle) {
+    waiter_.handle = handle;
+    waiter_.owner = this;
+    waiter_.deliver = &SampleAwaiter::deliver;
+    imu_->enqueue(&waiter_);
+}
+
+/* keeps the sample, resumes right away */
+bool AsyncImu::SampleAwaiter::deliver(Waiter *waiter, const ImuSample &sample) {
+    SampleAwaiter *self = static_cast<SampleAwaiter *>(waiter->owner);
+    self->sample_ = sample;
+    return true;
+}
+
+/* Constructor: batch_size must be at least 1 */
+AsyncImu::BatchStream::BatchStream(AsyncImu *imu, size_t batch_size) : imu_(imu) {
+    if (batch_size == 0) {
+        throw std::invalid_argument("The batch size must be at least 1.");
+    }
+    batch_.resize(batch_size);
+}
+
+/* returns an awaitable for the next full batch */
+AsyncImu::BatchStream::Awaiter AsyncImu::BatchStream::next() {
+    return Awaiter(this);
+}
+
+/* parks the coroutine until batch_size new samples arrived */
+void AsyncImu::BatchStream::Awaiter::await_suspend(std::coroutine_handle<> handle) {
+    stream_->count_ = 0;
+    stream_->waiter_.handle = handle;
+    stream_->waiter_.owner = stream_;
+    stream_->waiter_.deliver = &BatchStream::deliver;
+    stream_->imu_->enqueue(&stream_->waiter_);
+}
+
+/* appends the sample, resumes once the batch is full */
+bool AsyncImu::BatchStream::deliver(Waiter *waiter, const ImuSample &sample) {
+    BatchStream *self = static_cast<BatchStream *>(waiter->owner);
+    self->batch_[self->count_++] = sample;
+    return self->count_ == self->batch_.size();
+}
+
+} // namespace pimu
+
+#endif // __cpp_impl_coroutine
@@ -0,0 +1,265 @@
+#ifdef VSCODE_INTELLISENSE_SUPPORT
+#include "SpscRing.hpp"
+#endif
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace pimu {
+
+/*
+    append-only file written by a background thread
+    the producer copies records into a page aligned block, full blocks go to the writer thread through a lock-free queue
+    and come back empty through another one, so the producer never waits for the disk unless the policy says so
+    obs: one producer thread per writer
+*/
+class AsyncWriter {
+public:
+    /* what AsyncWriter::write() does when every block is waiting for the disk */
+    enum Policy
+    {
+        DROP,   // the record is discarded and counted
+        BLOCK,  // the producer waits for the writer thread
+        GROW    // a new block is allocated, up to max_blocks, then records are dropped
+    };
+
+    AsyncWriter(const std::string &path, size_t block_size = 65536, size_t num_blocks = 8, Policy policy = BLOCK,
+                size_t max_blocks = 256, bool append = false);
+    ~AsyncWriter();
+
+    bool write(const void *data, size_t size);
+    template<typename T> bool append(const T &record);
+    void flush();
+    void close();
+
+    uint64_t getBytesWritten();
+    uint64_t getRecordsDropped();
+    uint64_t getWriteErrors();
+    size_t getBlockCount();
+
+private:
+    struct Block
+    {
+        char *data;
+        size_t used;
+    };
+
+    int fd_ = -1;
+    size_t block_size_;
+    size_t max_blocks_;
+    Policy policy_;
+
+    std::vector<Block *> blocks_;           // every block allocated, owned here
+    Block *current_ = nullptr;              // block the producer is filling
+    SpscRing<Block *> full_;                // producer -> writer thread
+    SpscRing<Block *> free_;                // writer thread -> producer
+
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable work_ready_;    // a block was queued or close() was called
+    std::condition_variable block_freed_;   // a block came back, for the BLOCK policy
+    bool stop_requested_ = false;
+    bool running_ = false;
+
+    std::atomic<uint64_t> bytes_written_{0};
+    std::atomic<uint64_t> records_dropped_{0};
+    std::atomic<uint64_t> write_errors_{0};
+    std::atomic<size_t> num_blocks_{0};
+
+    Block *allocateBlock();
+    bool nextBlock();
+    void submit();
+    void run();
+    void writeBlock(Block *block);
+};
+
+/*
+    Constructor: opens (or truncates) the file, allocates num_blocks blocks of block_size bytes and starts the writer thread
+    obs: block_size is rounded up to 4096 bytes, append = true keeps what the file already holds
+*/
+AsyncWriter::AsyncWriter(const std::string &path, size_t block_size, size_t num_blocks, Policy policy, size_t max_blocks, bool append)
+    : block_size_((block_size + 4095) / 4096 * 4096), max_blocks_(max_blocks < num_blocks ? num_blocks : max_blocks),
+      policy_(policy), full_(max_blocks_), free_(max_blocks_) {
+    if (block_size == 0 || num_blocks < 2) {
+        throw std::invalid_argument("The writer needs at least 2 blocks of at least one byte.");
+    }
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC | (append ? O_APPEND : O_TRUNC), 0644);
+    if (fd_ < 0) {
+        throw std::runtime_error("Failed to open " + path + " for writing.");
+    }
+    try {
+        current_ = allocateBlock();
+        for (size_t i = 1; i < num_blocks; i++) free_.push(allocateBlock());
+    } catch (...) {
+        for (Block *block : blocks_) {
+            free(block->data);
+            delete block;
+        }
+        ::close(fd_);
+        throw;
+    }
+    thread_ = std::thread(&AsyncWriter::run, this);
+    running_ = true;
+}
+
+/* Destructor, writes what is left and stops the writer thread */
+AsyncWriter::~AsyncWriter() {
+    close();
+    for (Block *block : blocks_) {
+        free(block->data);
+        delete block;
+    }
+}
+
+/*
+    copies a record into the current block, returns false if it was dropped (see Policy), producer thread only
+    obs: a record never spans two blocks, one longer than the block size is dropped and counted as well
+*/
+bool AsyncWriter::write(const void *data, size_t size) {
+    if (!running_) return false;
+    if (size > block_size_) {
+        records_dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    if (current_ != nullptr && current_->used + size > block_size_) submit();
+    if (current_ == nullptr && !nextBlock()) {
+        records_dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    memcpy(current_->data + current_->used, data, size);
+    current_->used += size;
+    return true;
+}
+
+/* copies a trivially copyable record (e.g. BinaryLogRecord) as it is in memory */
+template<typename T>
+bool AsyncWriter::append(const T &record) {
+    return write(&record, sizeof(T));
+}
+
+/* hands the partially filled block to the writer thread, producer thread only */
+void AsyncWriter::flush() {
+    if (running_ && current_ != nullptr && current_->used > 0) submit();
+}
+
+/* writes every queued block, stops the writer thread and closes the file, producer thread only */
+void AsyncWriter::close() {
+    if (!running_) return;
+    flush();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_requested_ = true;
+    }
+    work_ready_.notify_one();
+    thread_.join();
+    running_ = false;
+    ::close(fd_);
+    fd_ = -1;
+}
+
+/* returns the number of bytes the writer thread stored in the file */
+uint64_t AsyncWriter::getBytesWritten() {
+    return bytes_written_.load(std::memory_order_relaxed);
+}
+
+/* returns the number of records discarded because no block was free or they were longer than a block */
+uint64_t AsyncWriter::getRecordsDropped() {
+    return records_dropped_.load(std::memory_order_relaxed);
+}
+
+/* returns the number of failed writes, the block is lost and the writer goes on with the next one */
+uint64_t AsyncWriter::getWriteErrors() {
+    return write_errors_.load(std::memory_order_relaxed);
+}
+
+/* returns the number of blocks allocated, grows with the GROW policy */
+size_t AsyncWriter::getBlockCount() {
+    return num_blocks_.load(std::memory_order_relaxed);
+}
+
+/* allocates a 4096 byte aligned block */
+AsyncWriter::Block *AsyncWriter::allocateBlock() {
+    void *data = nullptr;
+    if (posix_memalign(&data, 4096, block_size_) != 0) {
+        throw std::bad_alloc();
+    }
+    Block *block = new Block{static_cast<char *>(data), 0};
+    blocks_.push_back(block);
+    num_blocks_.store(blocks_.size(), std::memory_order_relaxed);
+    return block;
+}
+
+/* takes an empty block for the producer following the policy, returns false if there is none */
+bool AsyncWriter::nextBlock() {
+    if (free_.pop(current_)) return true;
+    current_ = nullptr;
+
+    if (policy_ == GROW && blocks_.size() < max_blocks_) {
+        current_ = allocateBlock();
+        return true;
+    }
+    if (policy_ == BLOCK) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        block_freed_.wait(lock, [this] { return free_.pop(current_); });
+        return true;
+    }
+    return false;
+}
+
+/* queues the current block for the writer thread */
+void AsyncWriter::submit() {
+    full_.push(current_); // the queue holds every block, it can't be full
+    current_ = nullptr;
+    std::lock_guard<std::mutex> lock(mutex_);
+    work_ready_.notify_one();
+}
+
+/* writer thread: writes full blocks in order and gives them back */
+void AsyncWriter::run() {
+    while (true) {
+        Block *block;
+        if (full_.pop(block)) {
+            writeBlock(block);
+            block->used = 0;
+            free_.push(block);
+            std::lock_guard<std::mutex> lock(mutex_);
+            block_freed_.notify_one();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (stop_requested_ && full_.size() == 0) break;
+        work_ready_.wait(lock, [this] { return stop_requested_ || full_.size() > 0; });
+    }
+}
+
+/* writes one block, retrying short writes */
+void AsyncWriter::writeBlock(Block *block) {
+    size_t done = 0;
+    while (done < block->used) {
+        ssize_t written = ::write(fd_, block->data + done, block->used - done);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "Failed to write the log: %s\n", strerror(errno));
+            write_errors_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        done += static_cast<size_t>(written);
+        bytes_written_.fetch_add(static_cast<uint64_t>(written), std::memory_order_relaxed);
+    }
+}
+
+} // namespace pimu
@@ -0,0 +1,328 @@
+#ifdef VSCODE_INTELLISENSE_SUPPORT
+#include "type.hpp"
+#endif
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+namespace pimu {
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "The binary log format is little-endian, records are copied as they are in memory."
+#endif
+
+/* channels of a log record, in SensorFrame order */
+const int kLogChannels = 10;
+
+/* one sample of a binary log, 32 bytes little-endian */
+struct BinaryLogRecord
+{
+    /* CLOCK_MONOTONIC time of the bus read [ns] */
+    uint64_t timestamp_ns;
+
+    /* module read counter (lower 32 bits), a gap means lost samples */
+    uint32_t seq;
+
+    /* raw counts: ax ay az temp gx gy gz hx hy hz */
+    int16_t raw[kLogChannels];
+};
+
+static_assert(sizeof(BinaryLogRecord) == 32, "A binary log record must be 32 bytes.");
+
+/* what a reader needs to turn the counts back into units, filled by Imu::getLogInfo() */
+struct BinaryLogInfo
+{
+    /* sample rate the log was recorded at [Hz] */
+    double sample_rate_hz = 0.0;
+
+    /* value = raw * scale + offset, in m/s2 (accel), C (temp), rad/s (gyro) and uT (mag) */
+    float scale[kLogChannels] = {};
+    float offset[kLogChannels] = {};
+
+    /* accel and gyro counts are in register axes, body = axis_transform * register (row major) */
+    int8_t axis_transform[3][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+
+    /* calibration applied by the Imu, not included in the counts [rad/s] and [G] */
+    Sensor gyro_bias = {0.0f, 0.0f, 0.0f};
+    Sensor accel_bias = {0.0f, 0.0f, 0.0f};
+};
+
+/* file header, records start at header_size */
+struct BinaryLogHeader
+{
+    char magic[8];              // "PIMULOG\0"
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t record_size;
+    uint32_t num_channels;
+    uint64_t record_count;      // records written, updated with every record
+    int64_t start_time_ns;      // CLOCK_REALTIME when the log was created
+    char channel_names[kLogChannels][8];
+    char channel_units[kLogChannels][8];
+    BinaryLogInfo info;
+};
+
+const char kBinaryLogMagic[8] = {'P', 'I', 'M', 'U', 'L', 'O', 'G', '\0'};
+const uint32_t kBinaryLogVersion = 1;
+const uint32_t kBinaryLogHeaderSize = 512;
+const size_t kBinaryLogChunk = 256 * 1024;
+
+static_assert(sizeof(BinaryLogHeader) <= kBinaryLogHeaderSize, "The binary log header does not fit.");
+
+/*
+    writes records to a file preallocated for max_records and mapped in memory, appending is a memcpy
+    obs: the file is cut to the records written when the writer is closed, one thread appends
+    only the chunk being written and the next one (kBinaryLogChunk bytes each) are accessible, the rest of the mapping is
+    PROT_NONE, so mlockall (RealtimeOptions::lock_memory) doesn't read the whole file in and pin it,
+    every finished chunk is unlocked and the one after the next is opened and read ahead
+*/
+class BinaryLogWriter {
+public:
+    BinaryLogWriter(const std::string &path, const BinaryLogInfo &info, size_t max_records);
+    ~BinaryLogWriter();
+
+    bool append(const SensorFrame &frame);
+    uint64_t getRecordCount();
+    size_t getCapacity();
+    void sync();
+    void close();
+
+private:
+    std::string path_;
+    int fd_ = -1;
+    void *map_ = MAP_FAILED;
+    size_t size_ = 0;
+    BinaryLogHeader *header_ = nullptr;
+    BinaryLogRecord *records_ = nullptr;
+    size_t capacity_ = 0;
+    uint64_t count_ = 0;
+    size_t chunk_start_ = 0;    // first byte of the chunk being written, the header page stays locked
+    size_t next_chunk_ = 0;     // byte offset where the next chunk starts, it is already accessible
+
+    void nextChunk();
+};
+
+/* maps a binary log read-only, records are accessed in place */
+class BinaryLogReader {
+public:
+    explicit BinaryLogReader(const std::string &path);
+    ~BinaryLogReader();
+
+    const BinaryLogHeader &getHeader();
+    uint64_t getRecordCount();
+    const BinaryLogRecord &getRecord(uint64_t index);
+    float getValue(const BinaryLogRecord &record, int channel);
+
+private:
+    void *map_ = MAP_FAILED;
+    size_t size_ = 0;
+    const BinaryLogHeader *header_ = nullptr;
+    const BinaryLogRecord *records_ = nullptr;
+    uint64_t count_ = 0;
+};
+
+/* Constructor: creates (or truncates) the file and preallocates max_records */
+BinaryLogWriter::BinaryLogWriter(const std::string &path, const BinaryLogInfo &info, size_t max_records)
+    : path_(path), capacity_(max_records) {
+    if (max_records == 0) {
+        throw std::invalid_argument("The log must hold at least one record.");
+    }
+    size_ = kBinaryLogHeaderSize + max_records * sizeof(BinaryLogRecord);
+
+    fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        throw std::runtime_error("Failed to create the log " + path_ + ".");
+    }
+    // reserve the blocks now, so appending never waits for the file system to allocate
+    if (posix_fallocate(fd_, 0, static_cast<off_t>(size_)) != 0 && ftruncate(fd_, static_cast<off_t>(size_)) < 0) {
+        ::close(fd_);
+        fd_ = -1;
+        throw std::runtime_error("Failed to preallocate the log " + path_ + ".");
+    }
+    // a record can cross into the next chunk, so two are opened
+    map_ = mmap(nullptr, size_, PROT_NONE, MAP_SHARED, fd_, 0);
+    if (map_ == MAP_FAILED || mprotect(map_, std::min(2 * kBinaryLogChunk, size_), PROT_READ | PROT_WRITE) != 0) {
+        if (map_ != MAP_FAILED) munmap(map_, size_);
+        map_ = MAP_FAILED;
+        ::close(fd_);
+        fd_ = -1;
+        throw std::runtime_error("Failed to map the log " + path_ + ".");
+    }
+    madvise(map_, size_, MADV_SEQUENTIAL);
+    chunk_start_ = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    next_chunk_ = kBinaryLogChunk;
+
+    const char *kNames[kLogChannels] = {"ax", "ay", "az", "temp", "gx", "gy", "gz", "hx", "hy", "hz"};
+    const char *kUnits[kLogChannels] = {"m/s2", "m/s2", "m/s2", "C", "rad/s", "rad/s", "rad/s", "uT", "uT", "uT"};
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    memset(map_, 0, kBinaryLogHeaderSize);
+    header_ = new (map_) BinaryLogHeader();
+    memcpy(header_->magic, kBinaryLogMagic, sizeof(kBinaryLogMagic));
+    header_->version = kBinaryLogVersion;
+    header_->header_size = kBinaryLogHeaderSize;
+    header_->record_size = sizeof(BinaryLogRecord);
+    header_->num_channels = kLogChannels;
+    header_->record_count = 0;
+    header_->start_time_ns = static_cast<int64_t>(now.tv_sec) * 1000000000LL + now.tv_nsec;
+    for (int i = 0; i < kLogChannels; i++) {
+        strncpy(header_->channel_names[i], kNames[i], sizeof(header_->channel_names[i]) - 1);
+        strncpy(header_->channel_units[i], kUnits[i], sizeof(header_->channel_units[i]) - 1);
+    }
+    header_->info = info;
+    records_ = reinterpret_cast<BinaryLogRecord *>(static_cast<char *>(map_) + kBinaryLogHeaderSize);
+}
+
+/* Destructor, closes the log */
+BinaryLogWriter::~BinaryLogWriter() {
+    close();
+}
+
+/* copies a frame into the next record, returns false if the log is full or closed */
+bool BinaryLogWriter::append(const SensorFrame &frame) {
+    if (count_ >= capacity_ || records_ == nullptr) return false;
+    BinaryLogRecord record;
+    record.timestamp_ns = static_cast<uint64_t>(frame.timestamp_ns);
+    record.seq = static_cast<uint32_t>(frame.seq);
+    record.raw[0] = frame.ax;
+    record.raw[1] = frame.ay;
+    record.raw[2] = frame.az;
+    record.raw[3] = frame.temp;
+    record.raw[4] = frame.gx;
+    record.raw[5] = frame.gy;
+    record.raw[6] = frame.gz;
+    record.raw[7] = frame.hx;
+    record.raw[8] = frame.hy;
+    record.raw[9] = frame.hz;
+    memcpy(&records_[count_], &record, sizeof(record));
+    header_->record_count = ++count_;
+    if (kBinaryLogHeaderSize + count_ * sizeof(BinaryLogRecord) >= next_chunk_) nextChunk();
+    return true;
+}
+
+/* unlocks the chunk just finished (no effect without mlockall), opens the one after the next and reads it ahead */
+void BinaryLogWriter::nextChunk() {
+    char *base = static_cast<char *>(map_);
+    if (next_chunk_ > chunk_start_) munlock(base + chunk_start_, next_chunk_ - chunk_start_);
+    chunk_start_ = next_chunk_;
+    next_chunk_ += kBinaryLogChunk;
+    if (next_chunk_ < size_) {
+        size_t length = std::min(kBinaryLogChunk, size_ - next_chunk_);
+        if (mprotect(base + next_chunk_, length, PROT_READ | PROT_WRITE) != 0) {
+            // the log ends with the records that fit in what is already accessible
+            capacity_ = std::min(capacity_, (next_chunk_ - kBinaryLogHeaderSize) / sizeof(BinaryLogRecord));
+            return;
+        }
+        madvise(base + next_chunk_, length, MADV_WILLNEED);
+    }
+}
+
+/* returns the number of records written */
+uint64_t BinaryLogWriter::getRecordCount() {
+    return count_;
+}
+
+/* returns the number of records the file was preallocated for */
+size_t BinaryLogWriter::getCapacity() {
+    return capacity_;
+}
+
+/* starts writing the dirty pages back without waiting for the disk */
+void BinaryLogWriter::sync() {
+    if (map_ != MAP_FAILED) msync(map_, size_, MS_ASYNC);
+}
+
+/* writes everything back, cuts the preallocated space that was not used and closes the file */
+void BinaryLogWriter::close() {
+    if (map_ == MAP_FAILED) return;
+    msync(map_, size_, MS_SYNC);
+    munmap(map_, size_);
+    map_ = MAP_FAILED;
+    header_ = nullptr;
+    records_ = nullptr;
+    if (ftruncate(fd_, static_cast<off_t>(kBinaryLogHeaderSize + count_ * sizeof(BinaryLogRecord))) < 0) {
+        fprintf(stderr, "Failed to cut the log %s to its records\n", path_.c_str());
+    }
+    ::close(fd_);
+    fd_ = -1;
+}
+
+/* Constructor: maps the file and checks its format */
+BinaryLogReader::BinaryLogReader(const std::string &path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open the log " + path + ".");
+    }
+    struct stat info;
+    if (fstat(fd, &info) < 0 || static_cast<size_t>(info.st_size) < kBinaryLogHeaderSize) {
+        ::close(fd);
+        throw std::runtime_error("The log " + path + " has no header.");
+    }
+    size_ = static_cast<size_t>(info.st_size);
+    map_ = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map_ == MAP_FAILED) {
+        throw std::runtime_error("Failed to map the log " + path + ".");
+    }
+
+    header_ = static_cast<const BinaryLogHeader *>(map_);
+    bool valid = memcmp(header_->magic, kBinaryLogMagic, sizeof(kBinaryLogMagic)) == 0 &&
+                 header_->version == kBinaryLogVersion && header_->record_size == sizeof(BinaryLogRecord) &&
+                 header_->num_channels == kLogChannels && header_->header_size >= kBinaryLogHeaderSize &&
+                 header_->header_size <= size_;
+    if (!valid) {
+        munmap(map_, size_);
+        map_ = MAP_FAILED;
+        throw std::runtime_error("The log " + path + " has a different format.");
+    }
+    records_ = reinterpret_cast<const BinaryLogRecord *>(static_cast<const char *>(map_) + header_->header_size);
+
+    // a log that was not closed still has its preallocated size, the header count is what was written
+    uint64_t stored = (size_ - header_->header_size) / sizeof(BinaryLogRecord);
+    count_ = header_->record_count < stored ? header_->record_count : stored;
+}
+
+/* Destructor */
+BinaryLogReader::~BinaryLogReader() {
+    if (map_ != MAP_FAILED) munmap(map_, size_);
+}
+
+/* returns the header: channels, units, scales, rate and calibration */
+const BinaryLogHeader &BinaryLogReader::getHeader() {
+    return *header_;
+}
+
+/* returns the number of records in the log */
+uint64_t BinaryLogReader::getRecordCount() {
+    return count_;
+}
+
+/* returns a record, index must be lower than getRecordCount() */
+const BinaryLogRecord &BinaryLogReader::getRecord(uint64_t index) {
+    if (index >= count_) {
+        throw std::out_of_range("The record index is out of the log.");
+    }
+    return records_[index];
+}
+
+/* converts a channel of a record to its unit (see BinaryLogHeader::channel_units) */
+float BinaryLogReader::getValue(const BinaryLogRecord &record, int channel) {
+    if (channel < 0 || channel >= kLogChannels) {
+        throw std::out_of_range("The channel does not exist.");
+    }
+    return record.raw[channel] * header_->info.scale[channel] + header_->info.offset[channel];
+}
+
+} // namespace pimu
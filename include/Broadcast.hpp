@@ -0,0 +1,244 @@
+#ifdef VSCODE_INTELLISENSE_SUPPORT
+#include "Realtime.hpp"
+#include "Seqlock.hpp"
+#endif
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <stdexcept>
+
+namespace pimu {
+
+/*
+    single producer / multiple consumer broadcast of fixed size records
+    the producer overwrites the oldest slot and never waits, every subscriber keeps its own cursor,
+    a subscriber that falls more than capacity records behind skips ahead and counts the lost records
+*/
+template<typename T>
+class Broadcast {
+private:
+    struct Entry
+    {
+        uint64_t index;
+        T value;
+    };
+
+    std::unique_ptr<Seqlock<Entry>[]> slots_;
+    size_t mask_;
+
+    alignas(64) std::atomic<uint64_t> head_{0};      // index of the next record, owned by the producer
+    alignas(64) std::atomic<uint32_t> wake_word_{0}; // futex word, changes on every publish
+    std::atomic<int> waiters_{0};
+
+public:
+    class Subscriber;
+
+    explicit Broadcast(size_t capacity);
+
+    void publish(const T &item);
+    Subscriber subscribe();
+    uint64_t getPublished();
+    size_t capacity();
+    void prefault() const;
+};
+
+/* read cursor of one consumer, a subscriber must be used from a single thread */
+template<typename T>
+class Broadcast<T>::Subscriber {
+public:
+    explicit Subscriber(Broadcast<T> *broadcast);
+
+    bool tryRead(T &item);
+    size_t readBatch(T *items, size_t max_items);
+    bool waitRead(T &item, int timeout_ms);
+    template<typename F> size_t dispatch(F &&callback, size_t max_items);
+    template<typename F> size_t waitDispatch(F &&callback, size_t max_items, int timeout_ms);
+    size_t available();
+    uint64_t getOverflowCount();
+
+private:
+    Broadcast<T> *broadcast_;
+    uint64_t cursor_;
+    uint64_t overflows_ = 0;
+
+    bool wait(int timeout_ms);
+};
+
+/* Constructor: capacity is rounded up to a power of two */
+template<typename T>
+Broadcast<T>::Broadcast(size_t capacity) {
+    if (capacity < 2) {
+        throw std::invalid_argument("The broadcast capacity must be at least 2.");
+    }
+    size_t rounded = 2;
+    while (rounded < capacity) rounded *= 2;
+    slots_.reset(new Seqlock<Entry>[rounded]);
+    mask_ = rounded - 1;
+}
+
+/* adds a record for every subscriber, never blocks, producer thread only */
+template<typename T>
+void Broadcast<T>::publish(const T &item) {
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    Entry entry;
+    entry.index = head;
+    entry.value = item;
+    slots_[head & mask_].store(entry);
+    head_.store(head + 1, std::memory_order_release);
+
+    // waking up is a system call, only made when a subscriber sleeps
+    wake_word_.fetch_add(1, std::memory_order_seq_cst);
+    if (waiters_.load(std::memory_order_seq_cst) > 0) {
+        syscall(SYS_futex, reinterpret_cast<uint32_t *>(&wake_word_), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+    }
+}
+
+/* returns a subscriber that receives the records published from now on */
+template<typename T>
+typename Broadcast<T>::Subscriber Broadcast<T>::subscribe() {
+    return Subscriber(this);
+}
+
+/* returns the number of records published so far */
+template<typename T>
+uint64_t Broadcast<T>::getPublished() {
+    return head_.load(std::memory_order_acquire);
+}
+
+/* returns the number of records kept for slow subscribers */
+template<typename T>
+size_t Broadcast<T>::capacity() {
+    return mask_ + 1;
+}
+
+/* Constructor: starts at the next record to be published */
+template<typename T>
+Broadcast<T>::Subscriber::Subscriber(Broadcast<T> *broadcast) : broadcast_(broadcast) {
+    cursor_ = broadcast_->head_.load(std::memory_order_acquire);
+}
+
+/* takes the next record, returns false if there is none */
+template<typename T>
+bool Broadcast<T>::Subscriber::tryRead(T &item) {
+    return readBatch(&item, 1) == 1;
+}
+
+/* takes up to max_items records in order, returns how many were copied */
+template<typename T>
+size_t Broadcast<T>::Subscriber::readBatch(T *items, size_t max_items) {
+    size_t count = 0;
+    while (count < max_items) {
+        uint64_t head = broadcast_->head_.load(std::memory_order_acquire);
+        if (cursor_ == head) break;
+
+        // the producer lapped this subscriber, skip to the oldest record still stored
+        uint64_t oldest = head > broadcast_->mask_ ? head - broadcast_->mask_ : 0;
+        if (cursor_ < oldest) {
+            overflows_ += oldest - cursor_;
+            cursor_ = oldest;
+        }
+
+        Entry entry = broadcast_->slots_[cursor_ & broadcast_->mask_].load();
+        if (entry.index != cursor_) continue; // overwritten while reading, recheck the head
+
+        items[count++] = entry.value;
+        cursor_++;
+    }
+    return count;
+}
+
+/* takes the next record, sleeps up to timeout_ms if there is none (-1 waits forever), returns false on timeout */
+template<typename T>
+bool Broadcast<T>::Subscriber::waitRead(T &item, int timeout_ms) {
+    if (tryRead(item)) return true;
+    return wait(timeout_ms) && tryRead(item);
+}
+
+/* calls callback(const T &) for up to max_items waiting records on the calling thread, returns how many were handled */
+template<typename T>
+template<typename F>
+size_t Broadcast<T>::Subscriber::dispatch(F &&callback, size_t max_items) {
+    const size_t kChunk = 16;
+    T items[kChunk];
+    size_t handled = 0;
+    while (handled < max_items) {
+        size_t count = readBatch(items, max_items - handled < kChunk ? max_items - handled : kChunk);
+        if (count == 0) break;
+        for (size_t i = 0; i < count; i++) callback(items[i]);
+        handled += count;
+    }
+    return handled;
+}
+
+/* same as Subscriber::dispatch(), sleeps up to timeout_ms first if there is nothing to handle */
+template<typename T>
+template<typename F>
+size_t Broadcast<T>::Subscriber::waitDispatch(F &&callback, size_t max_items, int timeout_ms) {
+    if (available() == 0 && !wait(timeout_ms)) return 0;
+    return dispatch(callback, max_items);
+}
+
+/* returns the number of records waiting, including the ones that will be lost to overflow */
+template<typename T>
+size_t Broadcast<T>::Subscriber::available() {
+    return static_cast<size_t>(broadcast_->head_.load(std::memory_order_acquire) - cursor_);
+}
+
+/* returns the number of records this subscriber lost because the producer overwrote them */
+template<typename T>
+uint64_t Broadcast<T>::Subscriber::getOverflowCount() {
+    return overflows_;
+}
+
+/* sleeps until a record is published or timeout_ms passes, returns true if there is something to read */
+template<typename T>
+bool Broadcast<T>::Subscriber::wait(int timeout_ms) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    if (timeout_ms >= 0) {
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += (timeout_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+    }
+
+    broadcast_->waiters_.fetch_add(1, std::memory_order_seq_cst);
+    while (available() == 0) {
+        // the word is read before checking the head, a publish in between makes the futex return at once
+        uint32_t word = broadcast_->wake_word_.load(std::memory_order_seq_cst);
+        if (available() > 0) break;
+
+        struct timespec remaining;
+        struct timespec *timeout = nullptr;
+        if (timeout_ms >= 0) {
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            int64_t left = (deadline.tv_sec - now.tv_sec) * 1000000000LL + (deadline.tv_nsec - now.tv_nsec);
+            if (left <= 0) break;
+            remaining.tv_sec = left / 1000000000LL;
+            remaining.tv_nsec = left % 1000000000LL;
+            timeout = &remaining;
+        }
+        syscall(SYS_futex, reinterpret_cast<uint32_t *>(&broadcast_->wake_word_), FUTEX_WAIT_PRIVATE, word, timeout, nullptr, 0);
+    }
+    broadcast_->waiters_.fetch_sub(1, std::memory_order_seq_cst);
+    return available() > 0;
+}
+
+/* touches every page of the slots, see prefaultMemory() */
+template<typename T>
+void Broadcast<T>::prefault() const {
+    prefaultMemory(slots_.get(), (mask_ + 1) * sizeof(Seqlock<Entry>));
+}
+
+} // namespace pimu
@@ -0,0 +1,161 @@
+#ifdef VSCODE_INTELLISENSE_SUPPORT
+#include "type.hpp"
+#include "Seqlock.hpp"
+#endif
+
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+
+namespace pimu {
+
+/* navigation state published by DeadReckoning */
+struct NavState
+{
+    /* position in the navigation frame (calibration pose axes, heading from gyro Z) [m] */
+    Sensor position;
+
+    /* velocity in the navigation frame [m/s] */
+    Sensor velocity;
+
+    /* rotation about X, Y and Z [rad] */
+    Sensor attitude;
+
+    /* integrated time since the last reset [s] */
+    double time;
+
+    /* number of stationary periods that zeroed the velocity */
+    uint64_t zero_velocity_updates;
+
+    /* true while the sensor is detected as stationary */
+    bool stationary;
+};
+
+/*
+    strapdown velocity and position integration for short tracking sessions
+    linear acceleration is rotated to the navigation frame and integrated (trapezoidal rule),
+    velocity is reset to zero while the sensor is detected as stationary (zero velocity update)
+*/
+class DeadReckoning {
+public:
+    DeadReckoning();
+
+    void setStationaryDetection(float accel_threshold_g, float gyro_threshold_rads, int num_samples);
+    void reset();
+    void update(const Sensor &linear_accel, const Sensor &gyro, float x_axis_angle, float y_axis_angle, float dt);
+    NavState getState();
+
+private:
+    NavState state_;       // only touched by the thread calling DeadReckoning::update()
+    Seqlock<NavState> published_;  // copy handed to readers, never blocks DeadReckoning::update()
+
+    Sensor previous_accel_ = {0.0f, 0.0f, 0.0f};
+    bool has_previous_ = false;
+    int still_samples_ = 0;
+
+    float accel_threshold_ = 0.03f;
+    float gyro_threshold_ = 0.05f;
+    int stationary_samples_ = 50;
+
+    const float kG_ = 9.807f;
+};
+
+/* Constructor: starts at the origin, at rest */
+DeadReckoning::DeadReckoning() {
+    reset();
+}
+
+/*
+    the sensor is stationary after num_samples consecutive samples with
+    |linear accel| < accel_threshold_g [G] and |gyro| < gyro_threshold_rads [rad/s]
+*/
+void DeadReckoning::setStationaryDetection(float accel_threshold_g, float gyro_threshold_rads, int num_samples) {
+    if (accel_threshold_g <= 0.0f || gyro_threshold_rads <= 0.0f || num_samples < 1) {
+        throw std::invalid_argument("The stationary thresholds and number of samples must be positive.");
+    }
+    accel_threshold_ = accel_threshold_g;
+    gyro_threshold_ = gyro_threshold_rads;
+    stationary_samples_ = num_samples;
+}
+
+/* moves back to the origin with zero velocity, should not be called while DeadReckoning::update() runs */
+void DeadReckoning::reset() {
+    state_ = NavState();
+    state_.position = {0.0f, 0.0f, 0.0f};
+    state_.velocity = {0.0f, 0.0f, 0.0f};
+    state_.attitude = {0.0f, 0.0f, 0.0f};
+    state_.time = 0.0;
+    state_.zero_velocity_updates = 0;
+    state_.stationary = false;
+    has_previous_ = false;
+    still_samples_ = 0;
+    published_.store(state_);
+}
+
+/*
+    integrates one sample, linear_accel [G] and gyro [rad/s] in body axes, X and Y angles [rad], dt [s]
+    meant to be called from the acquisition thread, it does not allocate
+*/
+void DeadReckoning::update(const Sensor &linear_accel, const Sensor &gyro, float x_axis_angle, float y_axis_angle, float dt) {
+    state_.attitude.x = x_axis_angle;
+    state_.attitude.y = y_axis_angle;
+    state_.attitude.z += gyro.z * dt;
+    state_.time += dt;
+
+    // body to navigation frame, R = Rz(z) * Rx(x) * Ry(y)
+    float cx = cos(state_.attitude.x), sx = sin(state_.attitude.x);
+    float cy = cos(state_.attitude.y), sy = sin(state_.attitude.y);
+    float cz = cos(state_.attitude.z), sz = sin(state_.attitude.z);
+
+    float ax = cy * linear_accel.x + sy * linear_accel.z;
+    float ay = linear_accel.y;
+    float az = -sy * linear_accel.x + cy * linear_accel.z;
+
+    float by = cx * ay - sx * az;
+    az = sx * ay + cx * az;
+    ay = by;
+
+    Sensor accel;
+    accel.x = (cz * ax - sz * ay) * kG_;
+    accel.y = (sz * ax + cz * ay) * kG_;
+    accel.z = az * kG_;
+    if (!has_previous_) {
+        previous_accel_ = accel;
+        has_previous_ = true;
+    }
+
+    // stationary detection
+    float accel_norm = sqrt(linear_accel.x * linear_accel.x + linear_accel.y * linear_accel.y + linear_accel.z * linear_accel.z);
+    float gyro_norm = sqrt(gyro.x * gyro.x + gyro.y * gyro.y + gyro.z * gyro.z);
+    if (accel_norm < accel_threshold_ && gyro_norm < gyro_threshold_) {
+        if (still_samples_ < stationary_samples_) still_samples_++;
+    } else {
+        still_samples_ = 0;
+    }
+    bool stationary = still_samples_ >= stationary_samples_;
+
+    if (stationary) {
+        // zero velocity update, position is kept
+        if (!state_.stationary) state_.zero_velocity_updates++;
+        state_.velocity = {0.0f, 0.0f, 0.0f};
+    } else {
+        Sensor velocity;
+        velocity.x = state_.velocity.x + 0.5f * (previous_accel_.x + accel.x) * dt;
+        velocity.y = state_.velocity.y + 0.5f * (previous_accel_.y + accel.y) * dt;
+        velocity.z = state_.velocity.z + 0.5f * (previous_accel_.z + accel.z) * dt;
+        state_.position.x += 0.5f * (state_.velocity.x + velocity.x) * dt;
+        state_.position.y += 0.5f * (state_.velocity.y + velocity.y) * dt;
+        state_.position.z += 0.5f * (state_.velocity.z + velocity.z) * dt;
+        state_.velocity = velocity;
+    }
+    state_.stationary = stationary;
+    previous_accel_ = accel;
+    published_.store(state_);
+}
+
+/* returns a consistent copy of position, velocity and attitude */
+NavState DeadReckoning::getState() {
+    return published_.load();
+}
+
+} // namespace pimu
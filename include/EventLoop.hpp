@@ -0,0 +1,120 @@
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace pimu {
+
+/*
+    single thread epoll loop, file descriptors (timerfd, sockets, gpio events, ...) are registered
+    with a function pointer and a context pointer, the handler runs on the loop thread when the fd is ready
+*/
+class EventLoop {
+public:
+    typedef void (*Handler)(void *context, uint32_t events);
+
+    EventLoop();
+    ~EventLoop();
+
+    int add(int fd, uint32_t events, Handler handler, void *context);
+    int remove(int fd);
+    int runOnce(int timeout_ms);
+    void run();
+    void stop();
+
+private:
+    struct Registration
+    {
+        Handler handler;
+        void *context;
+    };
+
+    int epoll_fd_ = -1;
+    int stop_fd_ = -1;      // eventfd written by EventLoop::stop()
+    bool stop_requested_ = false;
+    std::unordered_map<int, Registration> registrations_;
+};
+
+/* Constructor */
+EventLoop::EventLoop() {
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    stop_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (epoll_fd_ < 0 || stop_fd_ < 0) {
+        if (epoll_fd_ >= 0) close(epoll_fd_);
+        if (stop_fd_ >= 0) close(stop_fd_);
+        throw std::runtime_error("Failed to create the event loop.");
+    }
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = stop_fd_;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, stop_fd_, &event);
+}
+
+/* Destructor, the registered file descriptors are not closed */
+EventLoop::~EventLoop() {
+    close(epoll_fd_);
+    close(stop_fd_);
+}
+
+/* calls handler(context, events) on the loop thread whenever fd is ready for events (EPOLLIN, ...), returns -1 on error */
+int EventLoop::add(int fd, uint32_t events, Handler handler, void *context) {
+    struct epoll_event event = {};
+    event.events = events;
+    event.data.fd = fd;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0) return -1;
+    registrations_[fd] = {handler, context};
+    return 1;
+}
+
+/* stops watching fd, returns -1 if it was not registered */
+int EventLoop::remove(int fd) {
+    if (registrations_.erase(fd) == 0) return -1;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+    return 1;
+}
+
+/* waits up to timeout_ms (-1 forever) and runs the handlers of the ready fds, returns how many ran or -1 on error */
+int EventLoop::runOnce(int timeout_ms) {
+    const int kMaxEvents = 16;
+    struct epoll_event events[kMaxEvents];
+    int ready = epoll_wait(epoll_fd_, events, kMaxEvents, timeout_ms);
+    if (ready < 0) return errno == EINTR ? 0 : -1;
+
+    int handled = 0;
+    for (int i = 0; i < ready; i++) {
+        int fd = events[i].data.fd;
+        if (fd == stop_fd_) {
+            uint64_t pending;
+            while (read(stop_fd_, &pending, sizeof(pending)) == sizeof(pending)) {}
+            stop_requested_ = true;
+            continue;
+        }
+        // a handler may have removed this fd while handling an earlier event
+        auto registration = registrations_.find(fd);
+        if (registration == registrations_.end()) continue;
+        registration->second.handler(registration->second.context, events[i].events);
+        handled++;
+    }
+    return handled;
+}
+
+/* runs handlers until EventLoop::stop() */
+void EventLoop::run() {
+    stop_requested_ = false;
+    while (!stop_requested_) {
+        if (runOnce(-1) < 0) break;
+    }
+}
+
+/* makes EventLoop::run() return, can be called from any thread or from a handler */
+void EventLoop::stop() {
+    uint64_t one = 1;
+    ssize_t written = write(stop_fd_, &one, sizeof(one));
+    (void)written;
+}
+
+} // namespace pimu
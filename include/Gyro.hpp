@@ -1,13 +1,19 @@
 #ifdef VSCODE_INTELLISENSE_SUPPORT
 #include "LowPass.hpp"
+#include "Hampel.hpp"
+#include "Notch.hpp"
 #include "MPU9250.hpp"
 #include "operations.hpp"
 #include "type.hpp"
+#include "PeriodicTimer.hpp"
+#include "Profiler.hpp"
 #include "delay.hpp"
 #endif
 
 #include <unistd.h>
+#include <algorithm>
 #include <iostream>
+#include <stdexcept>
 #include <string>
 #include <chrono>
 
@@ -18,6 +24,11 @@ public:
     explicit Gyro(MPU9250 &module);
 
     void setFilterConstant(float constant);
+    void setSpikeFilter(int window_size, float num_deviations, float min_deviation = 0.0f);
+    void setNotchFilter(float sample_rate_hz, float bandwidth_hz, float min_hz, float max_hz, float adaptation_rate);
+    void setNotchFrequency(float frequency_hz);
+    Sensor getNotchFrequencies();
+    void setProfiler(LoopProfiler *profiler);
     
     int calibrate(int durationSeconds);
 
@@ -29,11 +40,21 @@ public:
     void setZAxisBias(float bias);
 
     Sensor read();
+    Sensor readUnrounded();
     void print(Sensor read_data);
 
     void updateAngles();
+    void setMaxDt(float max_dt);
+    void restartIntegration();
     float getXAxisAngle();
     float getYAxisAngle();
+    Sensor getLastReading();
+    SensorFrame getLastFrame();
+    float getLastDt();
+
+    uint64_t getXAxisRejected();
+    uint64_t getYAxisRejected();
+    uint64_t getZAxisRejected();
 
 private:
     MPU9250 &module_;
@@ -42,17 +63,29 @@ private:
     LowPass<float> y_axis_filter_;
     LowPass<float> z_axis_filter_;
 
+    Hampel<float> x_axis_spike_filter_;
+    Hampel<float> y_axis_spike_filter_;
+    Hampel<float> z_axis_spike_filter_;
+
+    Notch<float> x_axis_notch_;
+    Notch<float> y_axis_notch_;
+    Notch<float> z_axis_notch_;
+
     float x_axis_bias_ = 0.0f;
     float y_axis_bias_ = 0.0f;
     float z_axis_bias_ = 0.0f;
 
     float x_axis_angle_ = 0.0f;
     float y_axis_angle_ = 0.0f;
+    Sensor last_reading_ = {0.0f, 0.0f, 0.0f};
+    SensorFrame last_frame_ = {};   // frame Gyro::read() used, every axis comes from it
+    float last_dt_ = 0.0f;
     int calibration_num_samples_ = 0; // calibration samples counter
+    LoopProfiler *profiler_ = nullptr;
 
     bool gyro_timer_started_ = false;
-    struct timespec gyro_current_time;
-    struct timespec gyro_prev_time_;
+    int64_t prev_frame_ns_ = 0;   // CLOCK_MONOTONIC time of the frame integrated last
+    float max_dt_ = 0.1f;
 };
 
 /* pass mpu9250 module as parameter */
@@ -67,6 +100,54 @@ void Gyro::setFilterConstant(float constant) {
     z_axis_filter_.setAlpha(constant);
 }
 
+/* 
+    sets the outlier rejection applied before the low pass filters, window_size = 0 disables it 
+    samples further than num_deviations from the median of the last window_size samples are replaced by it [rad/s]
+*/
+void Gyro::setSpikeFilter(int window_size, float num_deviations, float min_deviation) {
+    x_axis_spike_filter_.setWindowSize(window_size);
+    y_axis_spike_filter_.setWindowSize(window_size);
+    z_axis_spike_filter_.setWindowSize(window_size);
+    x_axis_spike_filter_.setThreshold(num_deviations, min_deviation);
+    y_axis_spike_filter_.setThreshold(num_deviations, min_deviation);
+    z_axis_spike_filter_.setThreshold(num_deviations, min_deviation);
+}
+
+/* 
+    sets an adaptive notch per axis, applied after the spike filter and before the low pass filters
+    sample_rate_hz should match the rate Gyro::read() is called at, the notch tracks the dominant
+    vibration inside [min_hz, max_hz], adaptation_rate = 0 keeps it fixed (see Gyro::setNotchFrequency())
+*/
+void Gyro::setNotchFilter(float sample_rate_hz, float bandwidth_hz, float min_hz, float max_hz, float adaptation_rate) {
+    x_axis_notch_.setup(sample_rate_hz, bandwidth_hz, min_hz, max_hz);
+    y_axis_notch_.setup(sample_rate_hz, bandwidth_hz, min_hz, max_hz);
+    z_axis_notch_.setup(sample_rate_hz, bandwidth_hz, min_hz, max_hz);
+    x_axis_notch_.setAdaptationRate(adaptation_rate);
+    y_axis_notch_.setAdaptationRate(adaptation_rate);
+    z_axis_notch_.setAdaptationRate(adaptation_rate);
+}
+
+/* retunes every axis notch towards frequency_hz (e.g. a Spectrum peak), the change is smoothed over a few hundred samples */
+void Gyro::setNotchFrequency(float frequency_hz) {
+    x_axis_notch_.setCenterFrequency(frequency_hz);
+    y_axis_notch_.setCenterFrequency(frequency_hz);
+    z_axis_notch_.setCenterFrequency(frequency_hz);
+}
+
+/* returns the current notch frequency of each axis [Hz] */
+Sensor Gyro::getNotchFrequencies() {
+    Sensor frequencies;
+    frequencies.x = x_axis_notch_.getFrequency();
+    frequencies.y = y_axis_notch_.getFrequency();
+    frequencies.z = z_axis_notch_.getFrequency();
+    return frequencies;
+}
+
+/* records read, filter and angle update durations of every sample in profiler, nullptr disables it */
+void Gyro::setProfiler(LoopProfiler *profiler) {
+    profiler_ = profiler;
+}
+
 /* estimates the gyro biases by averaging, run this process for a duration in seconds */
 int Gyro::calibrate(int durationSeconds) {
     float gxbD = 0.0f;
@@ -80,15 +161,18 @@ int Gyro::calibrate(int durationSeconds) {
     this->setZAxisBias(0.0f);
 
     // take samples and find bias
-    auto start = std::chrono::high_resolution_clock::now();
-    auto end = start + std::chrono::seconds(durationSeconds);
-    while (std::chrono::high_resolution_clock::now() < end) {
+    // fixed rate sampling, the number of samples does not depend on how long each read takes
+    const int kRateHz = 50;
+    PeriodicTimer timer;
+    timer.start(kRateHz);
+    for (int i = 0; i < durationSeconds * kRateHz; i++) {
         calibration_num_samples_++;
         module_.readSensor();
-        gxbD += module_.getGyroX_rads();
-        gybD += module_.getGyroY_rads();
-        gzbD += module_.getGyroZ_rads();
-        delay(20);
+        Sensor gyro = module_.getGyro_rads(module_.getFrame());
+        gxbD += gyro.x;
+        gybD += gyro.y;
+        gzbD += gyro.z;
+        timer.wait();
     }
 
     // set offsets
@@ -119,6 +203,15 @@ void Gyro::setZAxisBias(float bias) { z_axis_bias_ = bias; }
 
 /* returns struct with the gyroscope readings in rad/s, with 2 decimals precision as 0.00 */
 Sensor Gyro::read() {
+    Sensor reading = readUnrounded();
+    return {round(reading.x, 2), round(reading.y, 2), round(reading.z, 2)};
+}
+
+/*
+    reads and filters the gyroscope like Gyro::read() but keeps the full resolution [rad/s]
+    obs: 0.01 rad/s steps are far above the sensor noise, averaging and integration need the unrounded rates
+*/
+Sensor Gyro::readUnrounded() {
     if (!x_axis_filter_.isAlphaDefined() || !y_axis_filter_.isAlphaDefined() || !z_axis_filter_.isAlphaDefined()) {
         std::cerr << "Falta definir la constante del filtro.\n";
     }
@@ -126,17 +219,23 @@ Sensor Gyro::read() {
     Sensor return_data;
 
     // read Sensor data
+    PIMU_PROFILE_START(read_start);
     module_.readSensor();
+    last_frame_ = module_.getFrame();
+    if (profiler_ != nullptr) PIMU_PROFILE_RECORD(*profiler_, LoopProfiler::READ, read_start);
 
-    // return data with low pass filter
-    float x_output = x_axis_filter_.filter(module_.getGyroX_rads());
-    float y_output = y_axis_filter_.filter(module_.getGyroY_rads());
-    float z_output = z_axis_filter_.filter(module_.getGyroZ_rads());
+    // reject spikes, remove the tracked vibration, then apply the low pass filter
+    PIMU_PROFILE_START(filter_start);
+    Sensor gyro = module_.getGyro_rads(last_frame_);
+    float x_output = x_axis_filter_.filter(x_axis_notch_.filter(x_axis_spike_filter_.filter(gyro.x)));
+    float y_output = y_axis_filter_.filter(y_axis_notch_.filter(y_axis_spike_filter_.filter(gyro.y)));
+    float z_output = z_axis_filter_.filter(z_axis_notch_.filter(z_axis_spike_filter_.filter(gyro.z)));
+    if (profiler_ != nullptr) PIMU_PROFILE_RECORD(*profiler_, LoopProfiler::FILTER, filter_start);
 
     // return data with offsets
-    return_data.x = round(x_output - x_axis_bias_, 2);
-    return_data.y = round(y_output - y_axis_bias_, 2);
-    return_data.z = round(z_output - z_axis_bias_, 2);
+    return_data.x = x_output - x_axis_bias_;
+    return_data.y = y_output - y_axis_bias_;
+    return_data.z = z_output - z_axis_bias_;
 
     return return_data;
 }
@@ -148,25 +247,43 @@ void Gyro::print(Sensor read_data) {
               << read_data.z << "kG_\n";
 }
 
-/* updates angles created from movement in the X and Y axis */
+/*
+    updates angles created from movement in the X and Y axis
+    obs: dt is the time between the monotonic timestamps of the frames read, so clock steps (NTP) don't affect it,
+    a frame reused by read coalescing gives dt = 0 and a gap longer than max_dt is integrated as max_dt
+*/
 void Gyro::updateAngles() {
-    // start gyro clock for angle measurement
-    if (!gyro_timer_started_) clock_gettime(CLOCK_REALTIME, &gyro_prev_time_);
-
-    gyro_timer_started_ = true;
+    // Actualizar ángulos usando la integración
+    Sensor SensorData = readUnrounded();
 
     // Obtener tiempo transcurrido en segundos (dt)
-    clock_gettime(CLOCK_REALTIME, &gyro_current_time);
-    float dt = (gyro_current_time.tv_sec - gyro_prev_time_.tv_sec) +
-                (gyro_current_time.tv_nsec - gyro_prev_time_.tv_nsec) / 1e9;
+    float dt = 0.0f;
+    if (gyro_timer_started_) {
+        dt = static_cast<float>(last_frame_.timestamp_ns - prev_frame_ns_) / 1e9f;
+        dt = std::min(std::max(dt, 0.0f), max_dt_);
+    }
+    gyro_timer_started_ = true;
+    prev_frame_ns_ = last_frame_.timestamp_ns;
 
-    // Actualizar ángulos usando la integración
-    Sensor SensorData = read();
+    PIMU_PROFILE_START(angles_start);
     x_axis_angle_ += SensorData.x * dt;
     y_axis_angle_ += SensorData.y * dt;
+    last_reading_ = SensorData;
+    last_dt_ = dt;
+    if (profiler_ != nullptr) PIMU_PROFILE_RECORD(*profiler_, LoopProfiler::ANGLES, angles_start);
+}
 
-    // Guardar el tiempo actual como referencia para la siguiente iteración
-    gyro_prev_time_ = gyro_current_time;
+/* sets the longest time step Gyro::updateAngles() integrates [s], a few periods of the loop calling it */
+void Gyro::setMaxDt(float max_dt) {
+    if (max_dt <= 0.0f) {
+        throw std::invalid_argument("The maximum time step must be positive.");
+    }
+    max_dt_ = max_dt;
+}
+
+/* the next Gyro::updateAngles() only takes the frame time as reference (dt = 0), e.g. after a pause */
+void Gyro::restartIntegration() {
+    gyro_timer_started_ = false;
 }
 
 /* returns angle x axis created angle */
@@ -175,4 +292,22 @@ float Gyro::getXAxisAngle() { return x_axis_angle_; }
 /* returns angle y axis created angle */
 float Gyro::getYAxisAngle() { return y_axis_angle_; }
 
+/* returns the unrounded reading used by the last Gyro::updateAngles() call [rad/s] */
+Sensor Gyro::getLastReading() { return last_reading_; }
+
+/* returns the sensor frame the last Gyro::read() filtered, accel and the rest of the channels come from the same read */
+SensorFrame Gyro::getLastFrame() { return last_frame_; }
+
+/* returns the time step used by the last Gyro::updateAngles() call [s] */
+float Gyro::getLastDt() { return last_dt_; }
+
+/* returns the number of X axis samples replaced by the spike filter */
+uint64_t Gyro::getXAxisRejected() { return x_axis_spike_filter_.getRejectedCount(); }
+
+/* returns the number of Y axis samples replaced by the spike filter */
+uint64_t Gyro::getYAxisRejected() { return y_axis_spike_filter_.getRejectedCount(); }
+
+/* returns the number of Z axis samples replaced by the spike filter */
+uint64_t Gyro::getZAxisRejected() { return z_axis_spike_filter_.getRejectedCount(); }
+
 } // namespace pimu
@@ -0,0 +1,310 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace pimu {
+
+/* largest Hampel window, bounds the memory of the filter and the depth of its tree */
+const int kHampelMaxWindow = 255;
+
+/*
+    sliding window outlier rejector (Hampel identifier)
+    each new sample is compared against the median and MAD of the previous N samples,
+    if it lies further than threshold * sigma it is replaced by the median
+    obs: the window is also kept in an order statistic tree (a treap whose nodes are the ring slots, nothing is
+    allocated per sample), a sample costs O(log N) to replace and to find the median, the MAD is a selection over
+    the distances below and above the median, O(log N) tree lookups so O(log^2 N)
+*/
+template<typename T>
+class Hampel {
+private:
+    struct Node
+    {
+        T value;
+        uint32_t priority;
+        int left;
+        int right;
+        int size;   // nodes in this subtree
+    };
+
+    std::vector<T> window_;   // last samples in arrival order (ring buffer)
+    std::vector<Node> nodes_; // one tree node per ring slot, ordered by (value, slot)
+    int root_ = -1;
+    uint32_t random_ = 2463534242u;
+    size_t size_ = 0;         // window size, 0 disables the filter
+    size_t head_ = 0;         // oldest sample position in window_
+    size_t count_ = 0;        // samples stored so far (warm up)
+
+    T threshold_ = static_cast<T>(3);
+    T min_deviation_ = static_cast<T>(0);
+
+    std::atomic<uint64_t> rejected_{0};
+
+    T median();
+    T medianAbsoluteDeviation(T median);
+    T nthDeviation(T median, size_t below, size_t n);
+
+    bool less(int a, int b);
+    int subtreeSize(int node);
+    void resize(int node);
+    int insert(int tree, int node);
+    int erase(int tree, int node);
+    T select(size_t rank);
+    size_t countBelow(T value);
+
+public:
+    Hampel();
+
+    void setWindowSize(int size);
+    void setThreshold(T num_deviations, T min_deviation);
+    bool isEnabled();
+    T filter(T input);
+    uint64_t getRejectedCount();
+    void reset();
+};
+
+/* Constructor: filter is disabled until a window size is defined */
+template<typename T>
+Hampel<T>::Hampel() {}
+
+/* sets the number of previous samples used as reference, 0 disables the filter, at most kHampelMaxWindow */
+template<typename T>
+void Hampel<T>::setWindowSize(int size) {
+    if (size < 0 || size == 1 || size == 2 || size > kHampelMaxWindow) {
+        throw std::invalid_argument("The window size must be 0 (disabled) or between 3 and 255 samples.");
+    }
+    size_ = static_cast<size_t>(size);
+    window_.assign(size_, static_cast<T>(0));
+    nodes_.assign(size_, Node());
+    reset();
+}
+
+/*
+    sets the rejection threshold as a number of standard deviations (estimated as 1.4826 * MAD),
+    deviations smaller than min_deviation are never rejected (avoids rejecting quantized flat signals)
+*/
+template<typename T>
+void Hampel<T>::setThreshold(T num_deviations, T min_deviation) {
+    if (num_deviations <= static_cast<T>(0) || min_deviation < static_cast<T>(0)) {
+        throw std::invalid_argument("The threshold must be positive and the minimum deviation non negative.");
+    }
+    threshold_ = num_deviations;
+    min_deviation_ = min_deviation;
+}
+
+/* checks if the filter has a window defined */
+template<typename T>
+bool Hampel<T>::isEnabled() {
+    return size_ > 0;
+}
+
+/* returns the input, or the window median if the input is an outlier */
+template<typename T>
+T Hampel<T>::filter(T input) {
+    if (size_ == 0) return input;
+
+    // warm up, fill the window before judging samples
+    if (count_ < size_) {
+        int slot = static_cast<int>(count_);
+        window_[slot] = input;
+        nodes_[slot].value = input;
+        root_ = insert(root_, slot);
+        count_++;
+        return input;
+    }
+
+    T output = input;
+    T med = median();
+    T limit = std::max(threshold_ * static_cast<T>(1.4826) * medianAbsoluteDeviation(med), min_deviation_);
+    if (std::abs(input - med) > limit) {
+        output = med;
+        rejected_.store(rejected_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    // the raw input enters the window so real steps are followed after N/2 samples, it reuses the oldest slot
+    int slot = static_cast<int>(head_);
+    root_ = erase(root_, slot);
+    window_[slot] = input;
+    nodes_[slot].value = input;
+    root_ = insert(root_, slot);
+    head_ = (head_ + 1) % size_;
+
+    return output;
+}
+
+/* returns the number of samples replaced since the last reset */
+template<typename T>
+uint64_t Hampel<T>::getRejectedCount() {
+    return rejected_.load(std::memory_order_relaxed);
+}
+
+/* empties the window and the rejected samples counter */
+template<typename T>
+void Hampel<T>::reset() {
+    head_ = 0;
+    count_ = 0;
+    root_ = -1;
+    rejected_.store(0, std::memory_order_relaxed);
+}
+
+/* median of the full window */
+template<typename T>
+T Hampel<T>::median() {
+    if (size_ % 2) return select(size_ / 2);
+    return (select(size_ / 2 - 1) + select(size_ / 2)) / static_cast<T>(2);
+}
+
+/* median of |x - median| */
+template<typename T>
+T Hampel<T>::medianAbsoluteDeviation(T med) {
+    size_t below = countBelow(med);
+    size_t target = size_ / 2;
+    if (size_ % 2) return nthDeviation(med, below, target);
+    return (nthDeviation(med, below, target - 1) + nthDeviation(med, below, target)) / static_cast<T>(2);
+}
+
+/*
+    n-th smallest |x - median| (from 0), the distances form two ascending runs: med - x for the below values
+    taken downwards and x - med for the rest taken upwards, a binary search finds how many come from each run
+*/
+template<typename T>
+T Hampel<T>::nthDeviation(T med, size_t below, size_t n) {
+    size_t above = size_ - below;
+    auto down = [&](size_t i) { return med - select(below - 1 - i); };
+    auto up = [&](size_t j) { return select(below + j) - med; };
+
+    // i distances from the lower run and n + 1 - i from the upper one are the n + 1 smallest
+    size_t low = n + 1 > above ? n + 1 - above : 0;
+    size_t high = std::min(n + 1, below);
+    while (low < high) {
+        size_t i = (low + high) / 2;
+        if (down(i) < up(n - i)) low = i + 1;
+        else high = i;
+    }
+    size_t j = n + 1 - low;
+    if (low == 0) return up(j - 1);
+    if (j == 0) return down(low - 1);
+    return std::max(down(low - 1), up(j - 1));
+}
+
+/* tree order: by value, equal values by ring slot so every node has a distinct key */
+template<typename T>
+bool Hampel<T>::less(int a, int b) {
+    return nodes_[a].value < nodes_[b].value || (nodes_[a].value == nodes_[b].value && a < b);
+}
+
+/* number of nodes under node, 0 for an empty subtree */
+template<typename T>
+int Hampel<T>::subtreeSize(int node) {
+    return node < 0 ? 0 : nodes_[node].size;
+}
+
+/* recomputes the subtree size of node from its children */
+template<typename T>
+void Hampel<T>::resize(int node) {
+    nodes_[node].size = 1 + subtreeSize(nodes_[node].left) + subtreeSize(nodes_[node].right);
+}
+
+/* inserts node (its value already set) into tree, returns the new root of tree */
+template<typename T>
+int Hampel<T>::insert(int tree, int node) {
+    if (tree < 0) {
+        // xorshift, the priorities only need to look random to keep the expected depth logarithmic
+        random_ ^= random_ << 13;
+        random_ ^= random_ >> 17;
+        random_ ^= random_ << 5;
+        nodes_[node].priority = random_;
+        nodes_[node].left = -1;
+        nodes_[node].right = -1;
+        nodes_[node].size = 1;
+        return node;
+    }
+    if (less(node, tree)) {
+        nodes_[tree].left = insert(nodes_[tree].left, node);
+        int child = nodes_[tree].left;
+        if (nodes_[child].priority > nodes_[tree].priority) {
+            // rotate right
+            nodes_[tree].left = nodes_[child].right;
+            nodes_[child].right = tree;
+            resize(tree);
+            resize(child);
+            return child;
+        }
+    } else {
+        nodes_[tree].right = insert(nodes_[tree].right, node);
+        int child = nodes_[tree].right;
+        if (nodes_[child].priority > nodes_[tree].priority) {
+            // rotate left
+            nodes_[tree].right = nodes_[child].left;
+            nodes_[child].left = tree;
+            resize(tree);
+            resize(child);
+            return child;
+        }
+    }
+    resize(tree);
+    return tree;
+}
+
+/* removes node from tree, returns the new root of tree */
+template<typename T>
+int Hampel<T>::erase(int tree, int node) {
+    if (tree == node) {
+        int left = nodes_[tree].left;
+        int right = nodes_[tree].right;
+        if (left < 0) return right;
+        if (right < 0) return left;
+        // rotate the child with the higher priority up and keep going down with node
+        if (nodes_[left].priority > nodes_[right].priority) {
+            nodes_[tree].left = nodes_[left].right;
+            nodes_[left].right = erase(tree, node);
+            resize(left);
+            return left;
+        }
+        nodes_[tree].right = nodes_[right].left;
+        nodes_[right].left = erase(tree, node);
+        resize(right);
+        return right;
+    }
+    if (less(node, tree)) nodes_[tree].left = erase(nodes_[tree].left, node);
+    else nodes_[tree].right = erase(nodes_[tree].right, node);
+    resize(tree);
+    return tree;
+}
+
+/* value with rank values below it in the window (0 is the smallest) */
+template<typename T>
+T Hampel<T>::select(size_t rank) {
+    int node = root_;
+    while (true) {
+        size_t left = static_cast<size_t>(subtreeSize(nodes_[node].left));
+        if (rank == left) return nodes_[node].value;
+        if (rank < left) {
+            node = nodes_[node].left;
+        } else {
+            rank -= left + 1;
+            node = nodes_[node].right;
+        }
+    }
+}
+
+/* number of window values strictly smaller than value */
+template<typename T>
+size_t Hampel<T>::countBelow(T value) {
+    size_t count = 0;
+    int node = root_;
+    while (node >= 0) {
+        if (nodes_[node].value < value) {
+            count += static_cast<size_t>(subtreeSize(nodes_[node].left)) + 1;
+            node = nodes_[node].right;
+        } else {
+            node = nodes_[node].left;
+        }
+    }
+    return count;
+}
+
+} // namespace pimu
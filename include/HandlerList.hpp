@@ -0,0 +1,170 @@
+#ifdef VSCODE_INTELLISENSE_SUPPORT
+#include "Profiler.hpp"
+#endif
+
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+
+namespace pimu {
+
+/* execution statistics of a handler registered in a HandlerList */
+struct HandlerStats
+{
+    /* duration of the calls [ns] */
+    LatencyStats timing;
+
+    /* allowed duration of one call [ns] */
+    int64_t budget_ns;
+
+    /* calls that took longer than the budget */
+    uint64_t over_budget;
+
+    /* true once the handler was suspended for exceeding its budget repeatedly */
+    bool suspended;
+};
+
+/*
+    fixed list of handlers called synchronously with every new value
+    a handler is a plain function pointer plus a context pointer, nothing is allocated or copied,
+    every call is timed, a handler that exceeds its budget too many times in a row is suspended
+*/
+template<typename T>
+class HandlerList {
+public:
+    typedef void (*Function)(void *context, const T &value);
+
+    static const int kMaxHandlers = 8;
+    static const int kMaxConsecutiveOverBudget = 10;
+
+    HandlerList();
+
+    int add(Function function, void *context, int64_t budget_ns);
+    template<typename F> int add(F &handler, int64_t budget_ns);
+    int remove(int id);
+    void call(const T &value);
+    HandlerStats getStats(int id);
+    int64_t getTotalBudget();
+
+private:
+    enum State { FREE, ACTIVE, SUSPENDED };
+
+    struct Slot
+    {
+        std::atomic<int> state{FREE};
+        std::atomic<bool> in_call{false};
+        Function function = nullptr;
+        void *context = nullptr;
+        int64_t budget_ns = 0;
+        int consecutive_over_budget = 0;        // calling thread only
+        std::atomic<uint64_t> over_budget{0};
+        LatencyHistogram timing;
+    };
+
+    Slot slots_[kMaxHandlers];
+};
+
+/* Constructor: starts empty */
+template<typename T>
+HandlerList<T>::HandlerList() {}
+
+/*
+    registers function(context, value), returns the handler id or -1 if the list is full
+    obs: adding and removing are not meant to run from several threads at once, use one control thread
+*/
+template<typename T>
+int HandlerList<T>::add(Function function, void *context, int64_t budget_ns) {
+    if (function == nullptr || budget_ns <= 0) {
+        throw std::invalid_argument("The handler must be a function with a positive budget.");
+    }
+    for (int id = 0; id < kMaxHandlers; id++) {
+        Slot &slot = slots_[id];
+        if (slot.state.load(std::memory_order_acquire) != FREE) continue;
+        slot.function = function;
+        slot.context = context;
+        slot.budget_ns = budget_ns;
+        slot.consecutive_over_budget = 0;
+        slot.over_budget.store(0, std::memory_order_relaxed);
+        slot.timing.reset();
+        slot.state.store(ACTIVE, std::memory_order_seq_cst);
+        return id;
+    }
+    return -1;
+}
+
+/* registers any callable with void operator()(const T &) by reference, it must outlive the registration */
+template<typename T>
+template<typename F>
+int HandlerList<T>::add(F &handler, int64_t budget_ns) {
+    return add([](void *context, const T &value) { (*static_cast<F *>(context))(value); }, &handler, budget_ns);
+}
+
+/* unregisters a handler, when it returns the handler is not running and will not be called again */
+template<typename T>
+int HandlerList<T>::remove(int id) {
+    if (id < 0 || id >= kMaxHandlers || slots_[id].state.load(std::memory_order_acquire) == FREE) return -1;
+    Slot &slot = slots_[id];
+    slot.state.store(FREE, std::memory_order_seq_cst);
+    while (slot.in_call.load(std::memory_order_seq_cst)) std::this_thread::yield();
+    return 1;
+}
+
+/* calls every active handler in registration slot order, times each call */
+template<typename T>
+void HandlerList<T>::call(const T &value) {
+    for (int id = 0; id < kMaxHandlers; id++) {
+        Slot &slot = slots_[id];
+        if (slot.state.load(std::memory_order_acquire) != ACTIVE) continue;
+
+        // announces the call before checking the state again, HandlerList::remove() waits for it
+        slot.in_call.store(true, std::memory_order_seq_cst);
+        if (slot.state.load(std::memory_order_seq_cst) != ACTIVE) {
+            slot.in_call.store(false, std::memory_order_release);
+            continue;
+        }
+
+        int64_t start = LoopProfiler::now();
+        slot.function(slot.context, value);
+        int64_t elapsed = LoopProfiler::now() - start;
+
+        slot.timing.record(elapsed);
+        if (elapsed > slot.budget_ns) {
+            slot.over_budget.store(slot.over_budget.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            // a slow handler is taken out of the loop before it costs more periods
+            if (++slot.consecutive_over_budget >= kMaxConsecutiveOverBudget) {
+                int active = ACTIVE;
+                slot.state.compare_exchange_strong(active, SUSPENDED, std::memory_order_acq_rel);
+            }
+        } else {
+            slot.consecutive_over_budget = 0;
+        }
+        // only now, HandlerList::add() may reuse the slot as soon as remove() sees it cleared
+        slot.in_call.store(false, std::memory_order_release);
+    }
+}
+
+/* returns timing, budget overruns and state of a handler */
+template<typename T>
+HandlerStats HandlerList<T>::getStats(int id) {
+    HandlerStats stats = {};
+    if (id < 0 || id >= kMaxHandlers) return stats;
+    Slot &slot = slots_[id];
+    stats.timing = slot.timing.getStats();
+    stats.budget_ns = slot.budget_ns;
+    stats.over_budget = slot.over_budget.load(std::memory_order_relaxed);
+    stats.suspended = slot.state.load(std::memory_order_acquire) == SUSPENDED;
+    return stats;
+}
+
+/* returns the sum of the budgets of the registered handlers [ns] */
+template<typename T>
+int64_t HandlerList<T>::getTotalBudget() {
+    int64_t total = 0;
+    for (int id = 0; id < kMaxHandlers; id++) {
+        if (slots_[id].state.load(std::memory_order_acquire) == ACTIVE) total += slots_[id].budget_ns;
+    }
+    return total;
+}
+
+} // namespace pimu
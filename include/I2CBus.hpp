@@ -0,0 +1,261 @@
+#ifdef VSCODE_INTELLISENSE_SUPPORT
+#include "Profiler.hpp"
+#endif
+
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+#endif
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace pimu {
+
+/*
+    one object per I2C bus device file, owns its file descriptor and serializes every transaction on it
+    threads waiting for the bus are served by priority: sensor reads (HIGH) go before configuration writes
+    and magnetometer housekeeping (LOW), the time each transaction waited for the bus is measured per priority
+*/
+class I2CBus {
+public:
+    enum Priority
+    {
+        HIGH,
+        LOW,
+        NUM_PRIORITIES
+    };
+
+    /* holds the bus for several transactions in a row (e.g. a register sequence that must not be interleaved) */
+    class Lock {
+    public:
+        Lock(I2CBus &bus, Priority priority) : bus_(bus) { bus_.acquire(priority); }
+        ~Lock() { bus_.release(); }
+        Lock(const Lock &) = delete;
+        Lock &operator=(const Lock &) = delete;
+
+    private:
+        I2CBus &bus_;
+    };
+
+    static I2CBus &get(const std::string &path);
+    ~I2CBus();
+
+    int read(uint8_t address, uint8_t reg, uint8_t length, uint8_t *data, Priority priority = HIGH);
+    int write(uint8_t address, uint8_t reg, uint8_t length, const uint8_t *data, Priority priority = LOW);
+
+    const std::string &getPath();
+    LatencyStats getQueueDelay(Priority priority);
+    uint64_t getTransactionCount(Priority priority);
+    uint64_t getErrorCount();
+    void resetStats();
+
+private:
+    explicit I2CBus(const std::string &path);
+
+    std::string path_;
+    int fd_ = -1;
+    int selected_address_ = -1;     // I2C_SLAVE address of the fd, for the fallback path
+
+    // arbitration, the owner may nest transactions inside a Lock
+    std::mutex mutex_;
+    std::condition_variable high_ready_;
+    std::condition_variable low_ready_;
+    std::thread::id owner_;
+    int depth_ = 0;
+    int waiting_high_ = 0;
+
+    // recorded while holding the bus, so there is one writer at a time
+    LatencyHistogram queue_delay_[NUM_PRIORITIES];
+    std::atomic<uint64_t> transactions_[NUM_PRIORITIES];
+    std::atomic<uint64_t> errors_{0};
+
+    void acquire(Priority priority);
+    void release();
+    int open();
+    int select(uint8_t address);
+};
+
+/* returns the manager of a bus (e.g. "/dev/i2c-1"), created on first use and shared by every device on it */
+I2CBus &I2CBus::get(const std::string &path) {
+    static std::mutex registry_mutex;
+    static std::map<std::string, std::unique_ptr<I2CBus>> registry;
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    std::unique_ptr<I2CBus> &bus = registry[path];
+    if (!bus) bus.reset(new I2CBus(path));
+    return *bus;
+}
+
+/* Constructor: the device file is opened by the first transaction */
+I2CBus::I2CBus(const std::string &path) : path_(path) {
+    for (int i = 0; i < NUM_PRIORITIES; i++) transactions_[i].store(0, std::memory_order_relaxed);
+}
+
+/* Destructor */
+I2CBus::~I2CBus() {
+    if (fd_ >= 0) ::close(fd_);
+}
+
+/*
+    reads length bytes starting at register reg of the device at address, returns length or -1 on error
+    obs: the register write and the read are a single combined transaction (repeated start)
+*/
+int I2CBus::read(uint8_t address, uint8_t reg, uint8_t length, uint8_t *data, Priority priority) {
+    Lock lock(*this, priority);
+    if (open() < 0) return -1;
+#ifdef __linux__
+    struct i2c_msg messages[2];
+    messages[0].addr = address;
+    messages[0].flags = 0;
+    messages[0].len = 1;
+    messages[0].buf = &reg;
+    messages[1].addr = address;
+    messages[1].flags = I2C_M_RD;
+    messages[1].len = length;
+    messages[1].buf = data;
+    struct i2c_rdwr_ioctl_data transfer = {messages, 2};
+    if (ioctl(fd_, I2C_RDWR, &transfer) != 2) {
+        fprintf(stderr, "Failed to read device %#x on %s: %s\n", address, path_.c_str(), strerror(errno));
+        errors_.fetch_add(1, std::memory_order_relaxed);
+        return -1;
+    }
+#else
+    if (select(address) < 0) return -1;
+    if (::write(fd_, &reg, 1) != 1 || ::read(fd_, data, length) != length) {
+        fprintf(stderr, "Failed to read device %#x on %s: %s\n", address, path_.c_str(), strerror(errno));
+        errors_.fetch_add(1, std::memory_order_relaxed);
+        return -1;
+    }
+#endif
+    return length;
+}
+
+/* writes length bytes starting at register reg of the device at address, returns 1 or -1 on error */
+int I2CBus::write(uint8_t address, uint8_t reg, uint8_t length, const uint8_t *data, Priority priority) {
+    if (length > 127) {
+        fprintf(stderr, "Byte write count (%d) > 127\n", length);
+        return -1;
+    }
+    uint8_t buffer[128];
+    buffer[0] = reg;
+    memcpy(buffer + 1, data, length);
+
+    Lock lock(*this, priority);
+    if (open() < 0) return -1;
+    if (select(address) < 0) return -1;
+    if (::write(fd_, buffer, length + 1) != length + 1) {
+        fprintf(stderr, "Failed to write device %#x on %s: %s\n", address, path_.c_str(), strerror(errno));
+        errors_.fetch_add(1, std::memory_order_relaxed);
+        return -1;
+    }
+    return 1;
+}
+
+/* returns the bus device file */
+const std::string &I2CBus::getPath() {
+    return path_;
+}
+
+/* returns how long transactions of a priority waited for the bus (count, p50, p99, max) [ns] */
+LatencyStats I2CBus::getQueueDelay(Priority priority) {
+    return queue_delay_[priority].getStats();
+}
+
+/* returns the number of times the bus was taken with a priority */
+uint64_t I2CBus::getTransactionCount(Priority priority) {
+    return transactions_[priority].load(std::memory_order_relaxed);
+}
+
+/* returns the number of failed transactions */
+uint64_t I2CBus::getErrorCount() {
+    return errors_.load(std::memory_order_relaxed);
+}
+
+/* discards the queue delays and counters measured so far */
+void I2CBus::resetStats() {
+    Lock lock(*this, LOW);
+    for (int i = 0; i < NUM_PRIORITIES; i++) {
+        queue_delay_[i].reset();
+        transactions_[i].store(0, std::memory_order_relaxed);
+    }
+    errors_.store(0, std::memory_order_relaxed);
+}
+
+/* waits for the bus, HIGH waiters always go first, nested calls from the owner thread return right away */
+void I2CBus::acquire(Priority priority) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    std::thread::id self = std::this_thread::get_id();
+    if (depth_ > 0 && owner_ == self) {
+        depth_++;
+        return;
+    }
+
+    int64_t start = LoopProfiler::now();
+    if (priority == HIGH) {
+        waiting_high_++;
+        high_ready_.wait(lock, [this] { return depth_ == 0; });
+        waiting_high_--;
+    } else {
+        low_ready_.wait(lock, [this] { return depth_ == 0 && waiting_high_ == 0; });
+    }
+    owner_ = self;
+    depth_ = 1;
+
+    queue_delay_[priority].record(LoopProfiler::now() - start);
+    transactions_[priority].store(transactions_[priority].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+/* frees the bus once the outermost holder is done and wakes the next waiter */
+void I2CBus::release() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--depth_ > 0) return;
+    owner_ = std::thread::id();
+    if (waiting_high_ > 0) {
+        high_ready_.notify_one();
+    } else {
+        low_ready_.notify_one();
+    }
+}
+
+/* opens the device file once, bus holder only */
+int I2CBus::open() {
+    if (fd_ >= 0) return 1;
+    fd_ = ::open(path_.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd_ < 0) {
+        fprintf(stderr, "Failed to open device: %s\n", strerror(errno));
+        errors_.fetch_add(1, std::memory_order_relaxed);
+        return -1;
+    }
+    selected_address_ = -1;
+    return 1;
+}
+
+/* points the plain read()/write() calls of the fd at a device, kept until another address is used, bus held */
+int I2CBus::select(uint8_t address) {
+#ifdef __linux__
+    if (selected_address_ != address) {
+        if (ioctl(fd_, I2C_SLAVE, address) < 0) {
+            fprintf(stderr, "Failed to select device %#x on %s: %s\n", address, path_.c_str(), strerror(errno));
+            errors_.fetch_add(1, std::memory_order_relaxed);
+            return -1;
+        }
+        selected_address_ = address;
+    }
+#endif
+    return 1;
+}
+
+} // namespace pimu
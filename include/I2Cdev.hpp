@@ -41,7 +41,11 @@ THE SOFTWARE.
 ===============================================
 */
 
-#ifdef linux
+#ifdef VSCODE_INTELLISENSE_SUPPORT
+#include "I2CBus.hpp"
+#endif
+
+#ifdef __linux__
 #include <sys/ioctl.h>
 #include <linux/i2c-dev.h>
 #endif
@@ -67,6 +71,7 @@ int8_t readBitsW(uint8_t devAddr, uint8_t regAddr, uint8_t bitStart, uint8_t len
 int8_t readByte(uint8_t devAddr, uint8_t regAddr, uint8_t *data);
 int8_t readWord(uint8_t devAddr, uint8_t regAddr, uint16_t *data);
 int8_t readBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t *data);
+int8_t readBytes(const char *bus, uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t *data);
 int8_t readWords(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint16_t *data);
 
 int writeBit(uint8_t devAddr, uint8_t regAddr, uint8_t bitNum, uint8_t data);
@@ -76,6 +81,7 @@ int writeBitsW(uint8_t devAddr, uint8_t regAddr, uint8_t bitStart, uint8_t lengt
 int writeByte(uint8_t devAddr, uint8_t regAddr, uint8_t data);
 int writeWord(uint8_t devAddr, uint8_t regAddr, uint16_t data);
 int writeBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t *data);
+int writeBytes(const char *bus, uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t *data);
 int writeWords(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint16_t *data);
 
 
@@ -84,6 +90,9 @@ int writeWords(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint16_t *data)
  * Set this to 0 to disable timeout detection.
  */
 uint16_t readTimeout = 0;
+/** Bus used by the functions that don't take one.
+ */
+const char *defaultBus = "/dev/i2c-1";
 /** Default constructor.
  */
 
@@ -199,41 +208,23 @@ int8_t readWord(uint8_t devAddr, uint8_t regAddr, uint16_t *data) {
  * @return Number of bytes read (-1 indicates failure)
  */
 int8_t readBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t *data) {
-    int8_t count = 0;
-#ifdef DEBUG
-printf("read %#x %#x %u\n",devAddr,regAddr,length);
-#endif
-int fd = open("/dev/i2c-1", O_RDWR);
-
-if (fd < 0) {
-    fprintf(stderr, "Failed to open device: %s\n", strerror(errno));
-    return(-1);
+    return readBytes(defaultBus, devAddr, regAddr, length, data);
 }
-#ifdef linux
-if (ioctl(fd, I2C_SLAVE, devAddr) < 0) {
-    fprintf(stderr, "Failed to select device: %s\n", strerror(errno));
-    close(fd);
-    return(-1);
-}
-#endif
-if (write(fd, &regAddr, 1) != 1) {
-    fprintf(stderr, "Failed to write reg: %s\n", strerror(errno));
-    close(fd);
-    return(-1);
-}
-count = read(fd, data, length);
-if (count < 0) {
-    fprintf(stderr, "Failed to read device(%d): %s\n", count, strerror(errno));
-    close(fd);
-    return(-1);
-} else if (count != length) {
-    fprintf(stderr, "Short read  from device, expected %d, got %d\n", length, count);
-    close(fd);
-    return(-1);
-}
-close(fd);
 
-return count;
+/** Read multiple bytes from an 8-bit device register on a given bus.
+ * @param bus I2C bus device file (e.g. /dev/i2c-1)
+ * @param devAddr I2C slave device address
+ * @param regAddr First register regAddr to read from
+ * @param length Number of bytes to read
+ * @param data Buffer to store read data in
+ * @return Number of bytes read (-1 indicates failure)
+ */
+int8_t readBytes(const char *bus, uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t *data) {
+#ifdef DEBUG
+    printf("read %s %#x %#x %u\n",bus,devAddr,regAddr,length);
+#endif
+    // shared, thread-safe bus manager, the device file stays open between calls
+    return I2CBus::get(bus).read(devAddr, regAddr, length, data, I2CBus::HIGH);
 }
 
 /** Read multiple words from a 16-bit device register.
@@ -368,45 +359,23 @@ int writeWord(uint8_t devAddr, uint8_t regAddr, uint16_t data) {
  * @return Status of operation (true = success)
  */
 int writeBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t* data) {
-    int8_t count = 0;
-    uint8_t buf[128];
-    int fd;
-    
+    return writeBytes(defaultBus, devAddr, regAddr, length, data);
+}
+
+/** Write multiple bytes to an 8-bit device register on a given bus.
+ * @param bus I2C bus device file (e.g. /dev/i2c-1)
+ * @param devAddr I2C slave device address
+ * @param regAddr First register address to write to
+ * @param length Number of bytes to write
+ * @param data Buffer to copy new data from
+ * @return Status of operation (true = success)
+ */
+int writeBytes(const char *bus, uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t* data) {
     #ifdef DEBUG
-    printf("write %#x %#x\n",devAddr,regAddr);
-    #endif
-    if (length > 127) {
-        fprintf(stderr, "Byte write count (%d) > 127\n", length);
-        return -1;
-    }
-    
-    fd = open("/dev/i2c-1", O_RDWR);
-    if (fd < 0) {
-        fprintf(stderr, "Failed to open device: %s\n", strerror(errno));
-        return -1;
-    }
-    #ifdef linux
-    if (ioctl(fd, I2C_SLAVE, devAddr) < 0) {
-        fprintf(stderr, "Failed to select device: %s\n", strerror(errno));
-        close(fd);
-        return -1;
-    }
+    printf("write %s %#x %#x\n",bus,devAddr,regAddr);
     #endif
-    buf[0] = regAddr;
-    memcpy(buf+1,data,length);
-    count = write(fd, buf, length+1);
-    if (count < 0) {
-        fprintf(stderr, "Failed to write device(%d): %s\n", count, strerror(errno));
-        close(fd);
-        return -1;
-    } else if (count != length+1) {
-        fprintf(stderr, "Short write to device, expected %d, got %d\n", length+1, count);
-        close(fd);
-        return -1;
-    }
-    close(fd);
-    
-    return 0;
+    // shared, thread-safe bus manager, the device file stays open between calls
+    return I2CBus::get(bus).write(devAddr, regAddr, length, data, I2CBus::LOW) < 0 ? -1 : 0;
 }
 
 /** Write multiple words to a 16-bit device register.
@@ -417,47 +386,20 @@ int writeBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t* data)
  * @return Status of operation (true = success)
  */
 int writeWords(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint16_t* data) {
-    int8_t count = 0;
-    uint8_t buf[128];
-    int i, fd;
-    
-    // Should do potential byteswap and call writeBytes() really, but that
-    // messes with the callers buffer
-    
+    uint8_t buf[126];
+
     if (length > 63) {
         fprintf(stderr, "Word write count (%d) > 63\n", length);
         return -1;
     }
-    
-    fd = open("/dev/i2c-1", O_RDWR);
-    if (fd < 0) {
-        fprintf(stderr, "Failed to open device: %s\n", strerror(errno));
-        return -1;
-    }
-    #ifdef linux
-    if (ioctl(fd, I2C_SLAVE, devAddr) < 0) {
-        fprintf(stderr, "Failed to select device: %s\n", strerror(errno));
-        close(fd);
-        return -1;
-    }
-    #endif
-    buf[0] = regAddr;
-    for (i = 0; i < length; i++) {
-        buf[i*2+1] = data[i] >> 8;
-        buf[i*2+2] = data[i];
-    }
-    count = write(fd, buf, length*2+1);
-    if (count < 0) {
-        fprintf(stderr, "Failed to write device(%d): %s\n", count, strerror(errno));
-        close(fd);
-        return -1;
-    } else if (count != length*2+1) {
-        fprintf(stderr, "Short write to device, expected %d, got %d\n", length+1, count);
-        close(fd);
-        return -1;
+
+    // big endian words, copied so the caller's buffer is not byteswapped
+    for (int i = 0; i < length; i++) {
+        buf[i*2] = data[i] >> 8;
+        buf[i*2+1] = data[i];
     }
-    close(fd);
-    return 0;
-} 
+    // through the bus manager like writeBytes(), so it is serialized with the other devices on the bus
+    return I2CBus::get(defaultBus).write(devAddr, regAddr, length * 2, buf, I2CBus::LOW) < 0 ? -1 : 0;
+}
 
 } // namespace pimu
\ No newline at end of file
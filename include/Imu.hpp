@@ -2,9 +2,26 @@
 #include "MPU9250.hpp"
 #include "Gyro.hpp"
 #include "Accel.hpp"
+#include "Spectrum.hpp"
+#include "DeadReckoning.hpp"
+#include "SpscRing.hpp"
+#include "Broadcast.hpp"
+#include "SharedRing.hpp"
+#include "BinaryLog.hpp"
+#include "Seqlock.hpp"
+#include "Realtime.hpp"
+#include "PeriodicTimer.hpp"
+#include "Profiler.hpp"
+#include "HandlerList.hpp"
+#include "type.hpp"
 #endif
 
 
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
 #include <thread>
 #include <iostream>
 
@@ -13,34 +30,116 @@ namespace pimu {
 class Imu {
 public:
     Imu(MPU9250 &module);
+    ~Imu();
 
     int begin();
     int calibrateGyro(int duration_seconds);
     int calibrateAccel(int duration_seconds);
     MultiSensor read();
+    ImuSample readSample();
     void print(MultiSensor read_data);
     void setGyroFilters(float filter_constant);
-    void startUpdateThread();
+    int setGyroSpikeFilter(int window_size, float num_deviations, float min_deviation = 0.0f);
+    uint64_t getGyroRejectedSamples();
+    int setGyroNotchFilter(float sample_rate_hz, float bandwidth_hz, float min_hz, float max_hz, float adaptation_rate);
+    void setGyroNotchFrequency(float frequency_hz);
+    Sensor getGyroNotchFrequencies();
+    int startUpdateThread();
+    void stopUpdateThread();
+    bool isUpdateThreadRunning();
+    void setUpdateRate(float rate_hz);
+    void setRealtimeOptions(const RealtimeOptions &options);
+    JitterReport getJitterReport();
+    uint64_t getUpdateOverruns();
+    LatencyStats getLatencyStats(LoopProfiler::Stage stage);
+    void resetLatencyStats();
+    void printLatencyStats();
+    void resetJitterReport();
+    int attachSpectrum(Spectrum *spectrum);
+    int attachDeadReckoning(DeadReckoning *dead_reckoning);
     float getXAxisAngle();
     float getYAxisAngle();
+    Sensor getLinearAccel();
+    ImuSample getLatestSample();
+    MPU9250 &getModule();
+    void update();
+    int claimDriver(float rate_hz);
+    void releaseDriver();
+    bool isDriven();
+    void prefaultBuffers(const RealtimeOptions &options);
+
+    int enableSampleRing(size_t capacity);
+    bool popSample(ImuSample &sample);
+    size_t popSamples(ImuSample *samples, size_t max_samples);
+    uint64_t getSampleOverflows();
+
+    int enableBroadcast(size_t capacity);
+    Broadcast<ImuSample>::Subscriber subscribe();
+    int enableSharedRing(const std::string &name, size_t capacity);
+    BinaryLogInfo getLogInfo();
+    int enableBinaryLog(const std::string &path, size_t max_records);
+    void closeBinaryLog();
+
+    int addSampleHandler(HandlerList<ImuSample>::Function function, void *context, int64_t budget_ns);
+    template<typename F> int addSampleHandler(F &handler, int64_t budget_ns);
+    int removeSampleHandler(int id);
+    HandlerStats getSampleHandlerStats(int id);
 
 private:
     MPU9250 &module_;
     Gyro gyro_;
     Accel accel_;
+    Spectrum *spectrum_ = nullptr;
+    DeadReckoning *dead_reckoning_ = nullptr;
 
     bool initialized_ = false;
     
-    float x_axis_angle_ = 0.0f;
-    float y_axis_angle_ = 0.0f;
+    // state published by the update thread, read from any thread
+    Seqlock<ImuSample> state_;
+    uint64_t seq_ = 0;
+    std::unique_ptr<SpscRing<ImuSample>> ring_;
+    std::unique_ptr<Broadcast<ImuSample>> broadcast_;
+    std::unique_ptr<SharedRingPublisher<ImuSample>> shared_ring_;
+    std::unique_ptr<BinaryLogWriter> binary_log_;
+    uint64_t logged_seq_ = 0;   // last module frame written to the binary log
+    HandlerList<ImuSample> handlers_;
 
     const float d2r_ = 3.14159265359f / 180.0f; 
+    const float kG_ = 9.807f;
+    const float kMaxDtPeriods_ = 4.0f; // longest time step integrated, in update periods
+
+    // true while a loop calls Imu::update() (update thread, ImuGroup, ImuArray, AsyncImu), set under thread_mutex_
+    std::atomic<bool> driven_{false};
+
+    // update thread
+    std::thread update_thread_;
+    std::mutex thread_mutex_;
+    PeriodicTimer timer_;
+    bool stop_requested_ = false;
+    float update_rate_hz_ = 500.0f;
+    RealtimeOptions realtime_options_;
+
+    // wakeup lateness, measured by the update thread
+    JitterMeter jitter_;
+    Seqlock<JitterReport> jitter_report_;
+    std::atomic<bool> jitter_reset_{false};
+    std::atomic<uint64_t> update_overruns_{0};
+
+    // per stage durations, recorded by the update thread
+    LoopProfiler profiler_;
 
     void startUpdateLoop();
 };
 
 /* Imu constructor */
-Imu::Imu(MPU9250 &module) : module_(module), gyro_(module), accel_(module) {}
+Imu::Imu(MPU9250 &module) : module_(module), gyro_(module), accel_(module) {
+    gyro_.setProfiler(&profiler_);
+}
+
+/* Imu destructor, stops the update thread before the members it uses are destroyed */
+Imu::~Imu() {
+    stopUpdateThread();
+}
 
 /* sets up mpu9250 communication */
 int Imu::begin() {
@@ -78,16 +177,19 @@ int Imu::calibrateAccel(int duration_seconds) {
     return 1;
 }
 
-/* returns gyro, accel and mag readings as a MultiSensor struct */
+/*
+    returns gyro and accel readings as a MultiSensor struct, rounded to 2 decimals, see Imu::readSample()
+    obs: while the Imu is driven (see Imu::isDriven()) the filters belong to that loop, so the readings come from
+    its last published sample instead of a new read
+*/
 MultiSensor Imu::read() {
+    ImuSample sample = readSample();
+    Sensor accel = accel_.toReading(sample.accel);
     MultiSensor return_data;
-    
-    Sensor gyro = gyro_.read();
-    return_data.gx = gyro.x;
-    return_data.gy = gyro.y;
-    return_data.gz = gyro.z;
+    return_data.gx = round(sample.gyro.x, 2);
+    return_data.gy = round(sample.gyro.y, 2);
+    return_data.gz = round(sample.gyro.z, 2);
 
-    Sensor accel = accel_.read();
     return_data.ax = accel.x;
     return_data.ay = accel.y;
     return_data.az = accel.z;
@@ -95,6 +197,25 @@ MultiSensor Imu::read() {
     return return_data;
 }
 
+/*
+    returns the readings at full resolution: filtered gyro [rad/s] and specific force, gravity included [G]
+    reads the sensor, or while driven returns the latest sample of the loop (see Imu::getLatestSample())
+    obs: without a loop seq and the angles are those of the last Imu::update(), the time is the frame time
+*/
+ImuSample Imu::readSample() {
+    // holding thread_mutex_ keeps a loop from claiming the Imu in the middle of the read
+    std::lock_guard<std::mutex> lock(thread_mutex_);
+    ImuSample sample = state_.load();
+    if (driven_.load()) return sample;
+
+    sample.gyro = gyro_.readUnrounded();
+    SensorFrame frame = gyro_.getLastFrame();
+    sample.timestamp_ns = frame.timestamp_ns;
+    sample.accel = accel_.getSpecificForce(frame);
+    sample.linear_accel = accel_.removeGravity(sample.accel, gyro_.getXAxisAngle(), gyro_.getYAxisAngle());
+    return sample;
+}
+
 /* prints the gyro and accelerometer readings from Imu::read() in a formatted output */
 void Imu::print(MultiSensor read_data) {
     std::cout << "Gyro (x, y, z): " << read_data.gx << "rad/s, " 
@@ -113,30 +234,477 @@ void Imu::setGyroFilters(float filter_constant) {
     gyro_.setFilterConstant(filter_constant);
 }
 
-/* starts thread with std::thread that updates angles measurements */
-void Imu::startUpdateThread() {
-    {   // sets update thread for angles
-        std::thread updateThread(&Imu::startUpdateLoop, this);
-        updateThread.detach();
+/* 
+    set outlier rejection for gyro readings, applied per axis before the low pass filters
+    obs: window_size = 0 (default) disables it, returns -1 while the Imu is driven (the windows are reallocated)
+*/
+int Imu::setGyroSpikeFilter(int window_size, float num_deviations, float min_deviation) {
+    std::lock_guard<std::mutex> lock(thread_mutex_);
+    if (driven_.load()) {
+        std::cout << "No se puede cambiar el filtro de picos con el Imu en actualizacion.\n";
+        return -1;
+    }
+    gyro_.setSpikeFilter(window_size, num_deviations, min_deviation);
+    return 1;
+}
+
+/* returns the total number of gyro samples replaced by the spike filter (all axes) */
+uint64_t Imu::getGyroRejectedSamples() {
+    return gyro_.getXAxisRejected() + gyro_.getYAxisRejected() + gyro_.getZAxisRejected();
+}
+
+/* 
+    set adaptive notch filters for gyro readings, applied per axis after the spike filter
+    obs: sample_rate_hz should match the update thread rate, adaptation_rate = 0 keeps the notch fixed,
+    returns -1 while the Imu is driven, use Imu::setGyroNotchFrequency() to retune a running filter
+*/
+int Imu::setGyroNotchFilter(float sample_rate_hz, float bandwidth_hz, float min_hz, float max_hz, float adaptation_rate) {
+    std::lock_guard<std::mutex> lock(thread_mutex_);
+    if (driven_.load()) {
+        std::cout << "No se puede configurar el filtro notch con el Imu en actualizacion.\n";
+        return -1;
+    }
+    gyro_.setNotchFilter(sample_rate_hz, bandwidth_hz, min_hz, max_hz, adaptation_rate);
+    return 1;
+}
+
+/* retunes the gyro notch filters towards a frequency, e.g. Spectrum::getPeakFrequency() [Hz], safe from any thread */
+void Imu::setGyroNotchFrequency(float frequency_hz) {
+    gyro_.setNotchFrequency(frequency_hz);
+}
+
+/* returns the frequency each gyro notch is currently centered at [Hz] */
+Sensor Imu::getGyroNotchFrequencies() {
+    return gyro_.getNotchFrequencies();
+}
+
+/* starts the thread that updates angles measurements, returns -1 if it is already running */
+int Imu::startUpdateThread() {
+    std::lock_guard<std::mutex> lock(thread_mutex_);
+    if (update_thread_.joinable()) {
+        std::cout << "El hilo de actualizacion ya esta en ejecucion.\n";
+        return -1;
+    }
+    if (driven_.load()) {
+        std::cout << "El Imu ya es actualizado por otro lazo (ImuGroup, ImuArray o AsyncImu).\n";
+        return -1;
+    }
+    driven_.store(true);
+    gyro_.restartIntegration();
+    gyro_.setMaxDt(kMaxDtPeriods_ / update_rate_hz_);
+    stop_requested_ = false;
+    update_thread_ = std::thread(&Imu::startUpdateLoop, this);
+    return 1;
+}
+
+/* stops the update thread, interrupts its sleep and waits for it to finish */
+void Imu::stopUpdateThread() {
+    {
+        std::lock_guard<std::mutex> lock(thread_mutex_);
+        if (!update_thread_.joinable()) return;
+        stop_requested_ = true;
     }
+    timer_.interrupt();
+    update_thread_.join();
+
+    std::lock_guard<std::mutex> lock(thread_mutex_);
+    update_thread_ = std::thread();
+    driven_.store(false);
+}
+
+/* returns true while the update thread is running */
+bool Imu::isUpdateThreadRunning() {
+    std::lock_guard<std::mutex> lock(thread_mutex_);
+    return update_thread_.joinable() && !stop_requested_;
+}
+
+/* sets the update thread rate [Hz], default is 500 Hz, can be changed while the thread runs */
+void Imu::setUpdateRate(float rate_hz) {
+    if (rate_hz <= 0.0f) {
+        throw std::invalid_argument("The update rate must be positive.");
+    }
+    std::lock_guard<std::mutex> lock(thread_mutex_);
+    update_rate_hz_ = rate_hz;
+}
+
+/*
+    sets priority, cpu affinity and memory locking of the update thread, applied when the thread starts
+    obs: options that need privileges print a warning and are skipped, the thread runs anyway
+*/
+void Imu::setRealtimeOptions(const RealtimeOptions &options) {
+    std::lock_guard<std::mutex> lock(thread_mutex_);
+    realtime_options_ = options;
+}
+
+/* returns how late the update thread woke up with respect to its period deadlines [us] */
+JitterReport Imu::getJitterReport() {
+    return jitter_report_.load();
+}
+
+/* returns the number of periods the update thread missed because Imu::update() took too long */
+uint64_t Imu::getUpdateOverruns() {
+    return update_overruns_.load(std::memory_order_relaxed);
+}
+
+/*
+    returns count, p50, p99 and max duration of an update thread stage [ns]
+    obs: all zero when built with PIMU_NO_PROFILING
+*/
+LatencyStats Imu::getLatencyStats(LoopProfiler::Stage stage) {
+    return profiler_.getStats(stage);
+}
+
+/* discards the stage durations measured so far */
+void Imu::resetLatencyStats() {
+    profiler_.reset();
+}
+
+/* prints p50, p99 and max of every update thread stage */
+void Imu::printLatencyStats() {
+    profiler_.print();
+}
+
+/* discards the jitter measured so far, takes effect on the next period */
+void Imu::resetJitterReport() {
+    jitter_reset_.store(true, std::memory_order_relaxed);
+}
+
+/* 
+    feeds every sample of the update thread (raw gyro [rad/s] and accel [G]) to a spectrum analyzer
+    obs: the spectrum sample rate should match the update thread rate, nullptr detaches it, returns -1 while driven
+*/
+int Imu::attachSpectrum(Spectrum *spectrum) {
+    std::lock_guard<std::mutex> lock(thread_mutex_);
+    if (driven_.load()) {
+        std::cout << "No se puede cambiar el analizador de espectro con el Imu en actualizacion.\n";
+        return -1;
+    }
+    spectrum_ = spectrum;
+    return 1;
+}
+
+/*
+    integrates velocity and position with every sample of the update thread
+    obs: nullptr detaches it, returns -1 while driven
+*/
+int Imu::attachDeadReckoning(DeadReckoning *dead_reckoning) {
+    std::lock_guard<std::mutex> lock(thread_mutex_);
+    if (driven_.load()) {
+        std::cout << "No se puede cambiar la navegacion inercial con el Imu en actualizacion.\n";
+        return -1;
+    }
+    dead_reckoning_ = dead_reckoning;
+    return 1;
 }
 
 /* returns angle x axis created angle */
-float Imu::getXAxisAngle() { return x_axis_angle_; }
+float Imu::getXAxisAngle() { return state_.load().x_axis_angle; }
 
 /* returns angle y axis created angle */
-float Imu::getYAxisAngle() { return y_axis_angle_; }
+float Imu::getYAxisAngle() { return state_.load().y_axis_angle; }
+
+/* returns the body frame acceleration with gravity removed, updated with the angles by the update thread [G] */
+Sensor Imu::getLinearAccel() { return state_.load().linear_accel; }
+
+/* returns the last sample of the update thread, every field comes from the same iteration, never blocks the thread */
+ImuSample Imu::getLatestSample() { return state_.load(); }
 
-/* updates X and Y axis angles */
+/* returns the sensor this Imu reads */
+MPU9250 &Imu::getModule() { return module_; }
+
+/*
+    marks the Imu as driven by a loop that calls Imu::update() at rate_hz from its own thread (ImuGroup, ImuArray, AsyncImu)
+    returns -1 if the update thread or another loop already drives it, release it with Imu::releaseDriver()
+    obs: while driven, the methods that replace what Imu::update() uses (enable*, attach*, filters setup) return -1
+*/
+int Imu::claimDriver(float rate_hz) {
+    if (rate_hz <= 0.0f) {
+        throw std::invalid_argument("The update rate must be positive.");
+    }
+    std::lock_guard<std::mutex> lock(thread_mutex_);
+    if (driven_.load()) {
+        std::cout << "El Imu ya es actualizado por otro lazo.\n";
+        return -1;
+    }
+    // the time without updates is not integrated
+    gyro_.restartIntegration();
+    gyro_.setMaxDt(kMaxDtPeriods_ / rate_hz);
+    driven_.store(true);
+    return 1;
+}
+
+/* ends a Imu::claimDriver(), the loop must not call Imu::update() anymore */
+void Imu::releaseDriver() {
+    std::lock_guard<std::mutex> lock(thread_mutex_);
+    driven_.store(false);
+}
+
+/* returns true while the update thread or another loop calls Imu::update() */
+bool Imu::isDriven() {
+    return driven_.load();
+}
+
+/*
+    touches the sample ring, broadcast and shared ring when options asks for locked memory or a prefaulted stack,
+    so the first samples don't page fault, called by the loop that drives the Imu after applyRealtimeOptions()
+    obs: the buffers can't be replaced while driven, so the loop reads them without the lock
+*/
+void Imu::prefaultBuffers(const RealtimeOptions &options) {
+    if (!options.lock_memory && options.prefault_stack_bytes == 0) return;
+    if (ring_) ring_->prefault();
+    if (broadcast_) broadcast_->prefault();
+    if (shared_ring_) shared_ring_->prefault();
+    prefaultMemory(this, sizeof(*this));
+}
+
+/* 
+    keeps every sample of the update thread in a lock-free ring of capacity samples (rounded up to a power of two)
+    should be called before Imu::startUpdateThread(), returns -1 while the Imu is driven (see Imu::isDriven())
+*/
+int Imu::enableSampleRing(size_t capacity) {
+    std::lock_guard<std::mutex> lock(thread_mutex_);
+    if (driven_.load()) {
+        std::cout << "No se puede crear el buffer de muestras con el Imu en actualizacion.\n";
+        return -1;
+    }
+    ring_.reset(new SpscRing<ImuSample>(capacity));
+    return 1;
+}
+
+/* takes the oldest sample produced by the update thread, returns false if there is none, single consumer */
+bool Imu::popSample(ImuSample &sample) {
+    return ring_ && ring_->pop(sample);
+}
+
+/* takes up to max_samples samples in order, returns how many were copied, single consumer */
+size_t Imu::popSamples(ImuSample *samples, size_t max_samples) {
+    return ring_ ? ring_->popBatch(samples, max_samples) : 0;
+}
+
+/* returns the number of samples lost because the consumer did not keep up */
+uint64_t Imu::getSampleOverflows() {
+    return ring_ ? ring_->getOverflowCount() : 0;
+}
+
+/*
+    shares every sample of the update thread with any number of subscribers, each one reads at its own pace
+    keeps the last capacity samples (rounded up to a power of two), should be called before Imu::startUpdateThread()
+    obs: only once, returns -1 if the broadcast already exists since the subscribers point into it
+*/
+int Imu::enableBroadcast(size_t capacity) {
+    std::lock_guard<std::mutex> lock(thread_mutex_);
+    if (driven_.load()) {
+        std::cout << "No se puede crear el buffer de difusion con el Imu en actualizacion.\n";
+        return -1;
+    }
+    if (broadcast_) {
+        std::cout << "El buffer de difusion ya fue creado.\n";
+        return -1;
+    }
+    broadcast_.reset(new Broadcast<ImuSample>(capacity));
+    return 1;
+}
+
+/* returns a subscriber that receives every sample published from now on, requires Imu::enableBroadcast() */
+Broadcast<ImuSample>::Subscriber Imu::subscribe() {
+    if (!broadcast_) {
+        throw std::logic_error("The sample broadcast must be enabled before subscribing.");
+    }
+    return broadcast_->subscribe();
+}
+
+/*
+    publishes every sample of the update thread in the shared memory object /dev/shm/<name> (name like "/pimu"),
+    other processes read it with SharedRingReader<ImuSample>, should be called before Imu::startUpdateThread()
+*/
+int Imu::enableSharedRing(const std::string &name, size_t capacity) {
+    std::lock_guard<std::mutex> lock(thread_mutex_);
+    if (driven_.load()) {
+        std::cout << "No se puede crear la memoria compartida con el Imu en actualizacion.\n";
+        return -1;
+    }
+    shared_ring_.reset();
+    shared_ring_.reset(new SharedRingPublisher<ImuSample>(name, capacity, update_rate_hz_));
+    return 1;
+}
+
+/* returns the scales, axes, rate and calibration a binary log of this Imu is described with */
+BinaryLogInfo Imu::getLogInfo() {
+    BinaryLogInfo info;
+    {
+        std::lock_guard<std::mutex> lock(thread_mutex_);
+        info.sample_rate_hz = update_rate_hz_;
+    }
+    module_.getFrameScales(info.scale, info.offset);
+    module_.getAxisTransform(info.axis_transform);
+    info.gyro_bias = {gyro_.getXAxisBias(), gyro_.getYAxisBias(), gyro_.getZAxisBias()};
+    info.accel_bias = {accel_.getXBias(), accel_.getYBias(), accel_.getZBias()};
+    return info;
+}
+
+/*
+    logs the raw frame of every update thread sample to a binary file preallocated for max_records (32 bytes each),
+    read it back with BinaryLogReader, should be called after calibrating and before Imu::startUpdateThread()
+    obs: the file is mapped, with RealtimeOptions::lock_memory only the chunks being written are locked (see BinaryLogWriter)
+*/
+int Imu::enableBinaryLog(const std::string &path, size_t max_records) {
+    BinaryLogInfo info = getLogInfo();
+    std::lock_guard<std::mutex> lock(thread_mutex_);
+    if (driven_.load()) {
+        std::cout << "No se puede crear el registro binario con el Imu en actualizacion.\n";
+        return -1;
+    }
+    binary_log_.reset();
+    binary_log_.reset(new BinaryLogWriter(path, info, max_records));
+    logged_seq_ = module_.getFrame().seq;
+    return 1;
+}
+
+/* closes the binary log, the file is cut to the records written, returns with no effect while the Imu is driven */
+void Imu::closeBinaryLog() {
+    std::lock_guard<std::mutex> lock(thread_mutex_);
+    if (driven_.load()) {
+        std::cout << "No se puede cerrar el registro binario con el Imu en actualizacion.\n";
+        return;
+    }
+    binary_log_.reset();
+}
+
+/*
+    registers function(context, sample), called by the update thread right after every sample is published
+    budget_ns is the longest a call may take, the budgets of all handlers must fit in half the update period,
+    returns the handler id or -1 if it does not fit
+*/
+int Imu::addSampleHandler(HandlerList<ImuSample>::Function function, void *context, int64_t budget_ns) {
+    std::lock_guard<std::mutex> lock(thread_mutex_);
+    int64_t period_ns = static_cast<int64_t>(1e9 / update_rate_hz_);
+    if (handlers_.getTotalBudget() + budget_ns > period_ns / 2) {
+        std::cout << "El manejador no entra en el presupuesto del ciclo: " << handlers_.getTotalBudget() + budget_ns
+                  << " ns de " << period_ns / 2 << " ns disponibles.\n";
+        return -1;
+    }
+    int id = handlers_.add(function, context, budget_ns);
+    if (id < 0) std::cout << "No se pueden registrar mas manejadores de muestras.\n";
+    return id;
+}
+
+/* registers any callable with void operator()(const ImuSample &) by reference, it must outlive the registration */
+template<typename F>
+int Imu::addSampleHandler(F &handler, int64_t budget_ns) {
+    return addSampleHandler([](void *context, const ImuSample &sample) { (*static_cast<F *>(context))(sample); }, &handler, budget_ns);
+}
+
+/* unregisters a handler, when it returns the update thread is no longer calling it */
+int Imu::removeSampleHandler(int id) {
+    std::lock_guard<std::mutex> lock(thread_mutex_);
+    return handlers_.remove(id);
+}
+
+/* returns the call duration percentiles of a handler, how often it went over budget and if it was suspended */
+HandlerStats Imu::getSampleHandlerStats(int id) {
+    return handlers_.getStats(id);
+}
+
+/* runs Imu::update() at the configured rate until Imu::stopUpdateThread() */
 void Imu::startUpdateLoop() {
+    std::unique_lock<std::mutex> lock(thread_mutex_);
+    RealtimeOptions options = realtime_options_;
+    float rate_hz = update_rate_hz_;
+    lock.unlock();
+    applyRealtimeOptions(options);
+    prefaultBuffers(options);
+    jitter_.reset();
+    jitter_report_.store(jitter_.getReport());
+    update_overruns_.store(0, std::memory_order_relaxed);
+
+    // absolute deadlines, the time Imu::update() takes does not shift the next period
+    timer_.start(rate_hz);
     while (true) {
-        gyro_.updateAngles();
-        
-        x_axis_angle_ = gyro_.getXAxisAngle() / d2r_; // radians to degrees
-        y_axis_angle_ = gyro_.getYAxisAngle() / d2r_; // radians to degrees
+        lock.lock();
+        if (stop_requested_) break;
+        if (update_rate_hz_ != rate_hz) {
+            rate_hz = update_rate_hz_;
+            timer_.setRate(rate_hz);
+            gyro_.setMaxDt(kMaxDtPeriods_ / rate_hz);
+        }
+        lock.unlock();
+
+        update();
+
+        // Imu::stopUpdateThread() interrupts the wait
+        int periods = timer_.wait();
+        if (periods == 0) continue;
+        if (periods < 0) {
+            std::cerr << "Error: Fallo la espera del temporizador, se detiene el hilo de actualizacion.\n";
+            break;
+        }
+
+        update_overruns_.store(timer_.getOverruns(), std::memory_order_relaxed);
+        if (jitter_reset_.exchange(false, std::memory_order_relaxed)) jitter_.reset();
+        jitter_.add(timer_.getLastLateness());
+        PIMU_PROFILE_VALUE(profiler_, LoopProfiler::WAKEUP, timer_.getLastLateness());
+        jitter_report_.store(jitter_.getReport());
+    }
+}
+
+/*
+    updates X and Y axis angles and the linear acceleration, publishes them as one sample
+    obs: called by the update thread, call it directly only to drive the Imu from another loop (ImuGroup, AsyncImu)
+    after a successful Imu::claimDriver()
+*/
+void Imu::update() {
+    PIMU_PROFILE_START(update_start);
+    gyro_.updateAngles();
+    SensorFrame frame = gyro_.getLastFrame();
+
+    // the time of the sensor read, not of this point: no filter latency, and a reused frame keeps its time
+    ImuSample sample;
+    sample.seq = seq_++;
+    sample.timestamp_ns = frame.timestamp_ns;
+    sample.gyro = gyro_.getLastReading();
+    sample.x_axis_angle = gyro_.getXAxisAngle() / d2r_; // radians to degrees
+    sample.y_axis_angle = gyro_.getYAxisAngle() / d2r_; // radians to degrees
+
+    // same frame and attitude, so consumers don't need to estimate orientation again
+    PIMU_PROFILE_START(publish_start);
+    sample.accel = accel_.getSpecificForce(frame);
+    sample.linear_accel = accel_.removeGravity(sample.accel, gyro_.getXAxisAngle(), gyro_.getYAxisAngle());
+
+    state_.store(sample);
+    if (ring_) ring_->push(sample);
+    if (broadcast_) broadcast_->publish(sample);
+    if (shared_ring_) shared_ring_->publish(sample);
+    if (binary_log_) {
+        // a frame reused by read coalescing is logged once
+        if (frame.seq != logged_seq_) {
+            binary_log_->append(frame);
+            logged_seq_ = frame.seq;
+        }
+    }
+    PIMU_PROFILE_RECORD(profiler_, LoopProfiler::PUBLISH, publish_start);
+
+    PIMU_PROFILE_START(consumers_start);
+    handlers_.call(sample);
+
+    if (dead_reckoning_ != nullptr) {
+        dead_reckoning_->update(sample.linear_accel, sample.gyro, gyro_.getXAxisAngle(), gyro_.getYAxisAngle(), gyro_.getLastDt());
+    }
 
-        delay(2);
+    // the gyro already read the sensor, reuse the same frame for the spectrum
+    if (spectrum_ != nullptr) {
+        Sensor gyro = module_.getGyro_rads(frame);
+        Sensor accel = module_.getAccel_mss(frame);
+        MultiSensor raw;
+        raw.gx = gyro.x;
+        raw.gy = gyro.y;
+        raw.gz = gyro.z;
+        raw.ax = accel.x / kG_;
+        raw.ay = accel.y / kG_;
+        raw.az = accel.z / kG_;
+        spectrum_->push(raw);
     }
+    PIMU_PROFILE_RECORD(profiler_, LoopProfiler::CONSUMERS, consumers_start);
+    PIMU_PROFILE_RECORD(profiler_, LoopProfiler::UPDATE, update_start);
 }
 
 } // namespace pimu
@@ -0,0 +1,220 @@
+#ifdef VSCODE_INTELLISENSE_SUPPORT
+#include "Imu.hpp"
+#include "PeriodicTimer.hpp"
+#include "Realtime.hpp"
+#include "Seqlock.hpp"
+#include "Broadcast.hpp"
+#include "type.hpp"
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <thread>
+
+namespace pimu {
+
+const int kMaxArrayImus = 8;
+
+/* samples of every Imu of an ImuArray interpolated to the same instant */
+struct ImuFrame
+{
+    /* frame counter, increases by one per period */
+    uint64_t seq;
+
+    /* grid time the samples are aligned to, CLOCK_MONOTONIC [ns] */
+    int64_t timestamp_ns;
+
+    /* number of valid entries in samples */
+    int num_imus;
+
+    /* per device sample at timestamp_ns, in the order the Imus were added */
+    ImuSample samples[kMaxArrayImus];
+
+    /* time of the actual read of each device relative to timestamp_ns [ns] */
+    int64_t read_offset_ns[kMaxArrayImus];
+};
+
+/*
+    synchronized acquisition of several Imus
+    one thread reads every device back to back right after each period deadline, each read is timestamped,
+    and the samples are linearly interpolated to the deadline so all devices of a frame describe the same instant
+*/
+class ImuArray {
+public:
+    explicit ImuArray(size_t frame_capacity = 256);
+    ~ImuArray();
+
+    int add(Imu &imu);
+    int start(float rate_hz);
+    void stop();
+    bool isRunning();
+    void setRealtimeOptions(const RealtimeOptions &options);
+
+    ImuFrame getLatestFrame();
+    Broadcast<ImuFrame>::Subscriber subscribe();
+    uint64_t getOverruns();
+
+private:
+    Imu *imus_[kMaxArrayImus];
+    int num_imus_ = 0;
+    ImuSample previous_[kMaxArrayImus];   // acquisition thread only
+
+    PeriodicTimer timer_;
+    std::thread thread_;
+    std::atomic<bool> stop_requested_{false};
+    bool running_ = false;
+    RealtimeOptions realtime_options_;
+    std::atomic<uint64_t> overruns_{0};
+
+    Seqlock<ImuFrame> latest_;
+    Broadcast<ImuFrame> frames_;
+
+    void run(float rate_hz);
+    static ImuSample interpolate(const ImuSample &before, const ImuSample &after, int64_t time_ns);
+};
+
+/* Constructor: frame_capacity frames are kept for slow subscribers */
+ImuArray::ImuArray(size_t frame_capacity) : frames_(frame_capacity) {}
+
+/* Destructor, stops the acquisition */
+ImuArray::~ImuArray() {
+    stop();
+}
+
+/* adds an Imu, returns -1 if the array is full, running, or something else drives the Imu */
+int ImuArray::add(Imu &imu) {
+    if (running_ || imu.isDriven() || num_imus_ >= kMaxArrayImus) {
+        std::cout << "No se puede agregar el Imu al arreglo.\n";
+        return -1;
+    }
+    imus_[num_imus_++] = &imu;
+    return 1;
+}
+
+/* starts reading every Imu at rate_hz, returns -1 if already running or if an Imu is driven by something else */
+int ImuArray::start(float rate_hz) {
+    if (rate_hz <= 0.0f) {
+        throw std::invalid_argument("The update rate must be positive.");
+    }
+    if (running_) {
+        std::cout << "El arreglo ya esta en ejecucion.\n";
+        return -1;
+    }
+    for (int i = 0; i < num_imus_; i++) {
+        if (imus_[i]->claimDriver(rate_hz) < 0) {
+            while (i-- > 0) imus_[i]->releaseDriver();
+            std::cout << "No se puede iniciar el arreglo, un Imu ya es actualizado por otro lazo.\n";
+            return -1;
+        }
+    }
+    stop_requested_.store(false);
+    overruns_.store(0, std::memory_order_relaxed);
+    thread_ = std::thread(&ImuArray::run, this, rate_hz);
+    running_ = true;
+    return 1;
+}
+
+/* stops and joins the acquisition thread */
+void ImuArray::stop() {
+    if (!running_) return;
+    stop_requested_.store(true);
+    timer_.interrupt();
+    thread_.join();
+    for (int i = 0; i < num_imus_; i++) imus_[i]->releaseDriver();
+    running_ = false;
+}
+
+/* returns true while the acquisition thread runs */
+bool ImuArray::isRunning() {
+    return running_;
+}
+
+/* priority, affinity and memory locking of the acquisition thread (see RealtimeOptions) */
+void ImuArray::setRealtimeOptions(const RealtimeOptions &options) {
+    realtime_options_ = options;
+}
+
+/* returns the last aligned frame, never blocks the acquisition */
+ImuFrame ImuArray::getLatestFrame() {
+    return latest_.load();
+}
+
+/* returns a subscriber that receives every frame published from now on */
+Broadcast<ImuFrame>::Subscriber ImuArray::subscribe() {
+    return frames_.subscribe();
+}
+
+/* returns the number of periods missed because reading all devices took too long */
+uint64_t ImuArray::getOverruns() {
+    return overruns_.load(std::memory_order_relaxed);
+}
+
+/* acquisition thread */
+void ImuArray::run(float rate_hz) {
+    applyRealtimeOptions(realtime_options_);
+    for (int i = 0; i < num_imus_; i++) imus_[i]->prefaultBuffers(realtime_options_);
+    if (realtime_options_.lock_memory || realtime_options_.prefault_stack_bytes > 0) frames_.prefault();
+
+    // the first read of every device only seeds the interpolation
+    for (int i = 0; i < num_imus_; i++) {
+        imus_[i]->update();
+        previous_[i] = imus_[i]->getLatestSample();
+    }
+
+    uint64_t seq = 0;
+    timer_.start(rate_hz);
+    while (!stop_requested_.load()) {
+        int periods = timer_.wait();
+        if (periods == 0) continue;
+        if (periods < 0) {
+            std::cerr << "Error: Fallo la espera del temporizador del arreglo de Imus.\n";
+            break;
+        }
+        overruns_.store(timer_.getOverruns(), std::memory_order_relaxed);
+
+        // back to back reads, each sample keeps the time of its own read
+        ImuFrame frame;
+        frame.seq = seq++;
+        frame.timestamp_ns = timer_.getLastDeadline();
+        frame.num_imus = num_imus_;
+        for (int i = 0; i < num_imus_; i++) {
+            imus_[i]->update();
+            ImuSample current = imus_[i]->getLatestSample();
+            frame.samples[i] = interpolate(previous_[i], current, frame.timestamp_ns);
+            frame.read_offset_ns[i] = current.timestamp_ns - frame.timestamp_ns;
+            previous_[i] = current;
+        }
+        for (int i = num_imus_; i < kMaxArrayImus; i++) {
+            frame.samples[i] = ImuSample();
+            frame.read_offset_ns[i] = 0;
+        }
+
+        latest_.store(frame);
+        frames_.publish(frame);
+    }
+}
+
+/* linear interpolation of every field at time_ns, clamped to the two samples */
+ImuSample ImuArray::interpolate(const ImuSample &before, const ImuSample &after, int64_t time_ns) {
+    float fraction = 1.0f;
+    int64_t span = after.timestamp_ns - before.timestamp_ns;
+    if (span > 0) {
+        fraction = static_cast<float>(time_ns - before.timestamp_ns) / static_cast<float>(span);
+        fraction = std::min(std::max(fraction, 0.0f), 1.0f);
+    }
+    auto mix = [fraction](float a, float b) { return a + fraction * (b - a); };
+
+    ImuSample sample;
+    sample.seq = after.seq;
+    sample.timestamp_ns = time_ns;
+    sample.gyro = {mix(before.gyro.x, after.gyro.x), mix(before.gyro.y, after.gyro.y), mix(before.gyro.z, after.gyro.z)};
+    sample.accel = {mix(before.accel.x, after.accel.x), mix(before.accel.y, after.accel.y), mix(before.accel.z, after.accel.z)};
+    sample.linear_accel = {mix(before.linear_accel.x, after.linear_accel.x), mix(before.linear_accel.y, after.linear_accel.y),
+                           mix(before.linear_accel.z, after.linear_accel.z)};
+    sample.x_axis_angle = mix(before.x_axis_angle, after.x_axis_angle);
+    sample.y_axis_angle = mix(before.y_axis_angle, after.y_axis_angle);
+    return sample;
+}
+
+} // namespace pimu
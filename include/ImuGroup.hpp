@@ -0,0 +1,187 @@
+#ifdef VSCODE_INTELLISENSE_SUPPORT
+#include "Imu.hpp"
+#include "PeriodicTimer.hpp"
+#include "Realtime.hpp"
+#endif
+
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace pimu {
+
+/*
+    samples several Imus at a common rate with one worker thread per I2C bus
+    buses are read in parallel, the devices of a bus are updated back to back in every period
+    so they share one wakeup and never compete for the bus
+*/
+class ImuGroup {
+public:
+    ImuGroup();
+    ~ImuGroup();
+
+    int add(Imu &imu);
+    int start(float rate_hz);
+    void stop();
+    bool isRunning();
+    void setRealtimeOptions(const RealtimeOptions &options);
+    int setBusCpu(const std::string &path, int cpu);
+    size_t getBusCount();
+    uint64_t getOverruns();
+
+private:
+    struct Bus
+    {
+        std::string path;
+        std::vector<Imu *> imus;
+        int cpu = -1;   // setBusCpu(), -1 uses RealtimeOptions::cpu when there is a single bus
+        PeriodicTimer timer;
+        std::thread thread;
+        std::atomic<uint64_t> overruns{0};
+    };
+
+    std::vector<std::unique_ptr<Bus>> buses_;
+    std::atomic<bool> stop_requested_{false};
+    bool running_ = false;
+    RealtimeOptions realtime_options_;
+
+    void run(Bus *bus, float rate_hz);
+};
+
+/* Constructor: starts empty */
+ImuGroup::ImuGroup() {}
+
+/* Destructor, stops the workers */
+ImuGroup::~ImuGroup() {
+    stop();
+}
+
+/* adds an Imu to the worker of its bus, returns -1 if the group is running or something else drives the Imu */
+int ImuGroup::add(Imu &imu) {
+    if (running_ || imu.isDriven()) {
+        std::cout << "No se puede agregar el Imu con el grupo o su hilo de actualizacion en ejecucion.\n";
+        return -1;
+    }
+    const std::string &path = imu.getModule().getBus();
+    for (auto &bus : buses_) {
+        if (bus->path == path) {
+            bus->imus.push_back(&imu);
+            return 1;
+        }
+    }
+    buses_.emplace_back(new Bus());
+    buses_.back()->path = path;
+    buses_.back()->imus.push_back(&imu);
+    return 1;
+}
+
+/*
+    starts one worker per bus updating its Imus at rate_hz
+    returns -1 if already running or if an Imu is driven by something else (its update thread, another group)
+*/
+int ImuGroup::start(float rate_hz) {
+    if (rate_hz <= 0.0f) {
+        throw std::invalid_argument("The update rate must be positive.");
+    }
+    if (running_) {
+        std::cout << "El grupo ya esta en ejecucion.\n";
+        return -1;
+    }
+    // every Imu is claimed before any worker starts, so none is updated by two loops
+    std::vector<Imu *> claimed;
+    for (auto &bus : buses_) {
+        for (Imu *imu : bus->imus) {
+            if (imu->claimDriver(rate_hz) < 0) {
+                for (Imu *other : claimed) other->releaseDriver();
+                std::cout << "No se puede iniciar el grupo, un Imu ya es actualizado por otro lazo.\n";
+                return -1;
+            }
+            claimed.push_back(imu);
+        }
+    }
+    stop_requested_.store(false);
+    for (auto &bus : buses_) {
+        bus->overruns.store(0, std::memory_order_relaxed);
+        bus->thread = std::thread(&ImuGroup::run, this, bus.get(), rate_hz);
+    }
+    running_ = true;
+    return 1;
+}
+
+/* stops and joins every worker */
+void ImuGroup::stop() {
+    if (!running_) return;
+    stop_requested_.store(true);
+    for (auto &bus : buses_) bus->timer.interrupt();
+    for (auto &bus : buses_) bus->thread.join();
+    for (auto &bus : buses_) {
+        for (Imu *imu : bus->imus) imu->releaseDriver();
+    }
+    running_ = false;
+}
+
+/* returns true while the workers run */
+bool ImuGroup::isRunning() {
+    return running_;
+}
+
+/*
+    priority, affinity and memory locking applied by every worker when it starts (see RealtimeOptions)
+    obs: RealtimeOptions::cpu is only used with a single bus, so parallel buses are not pinned to one core, see setBusCpu()
+*/
+void ImuGroup::setRealtimeOptions(const RealtimeOptions &options) {
+    realtime_options_ = options;
+}
+
+/* pins the worker of a bus to a cpu (-1 lets it move), returns -1 if the group runs or no Imu is on that bus */
+int ImuGroup::setBusCpu(const std::string &path, int cpu) {
+    if (running_) {
+        std::cout << "No se puede cambiar la cpu con el grupo en ejecucion.\n";
+        return -1;
+    }
+    for (auto &bus : buses_) {
+        if (bus->path == path) {
+            bus->cpu = cpu;
+            return 1;
+        }
+    }
+    std::cout << "No hay Imus en el bus " << path << ".\n";
+    return -1;
+}
+
+/* returns the number of buses, one worker thread each */
+size_t ImuGroup::getBusCount() {
+    return buses_.size();
+}
+
+/* returns the periods missed by all workers */
+uint64_t ImuGroup::getOverruns() {
+    uint64_t overruns = 0;
+    for (auto &bus : buses_) overruns += bus->overruns.load(std::memory_order_relaxed);
+    return overruns;
+}
+
+/* worker of one bus */
+void ImuGroup::run(Bus *bus, float rate_hz) {
+    RealtimeOptions options = realtime_options_;
+    if (bus->cpu >= 0 || buses_.size() > 1) options.cpu = bus->cpu;
+    applyRealtimeOptions(options);
+    for (Imu *imu : bus->imus) imu->prefaultBuffers(options);
+    bus->timer.start(rate_hz);
+    while (!stop_requested_.load()) {
+        for (Imu *imu : bus->imus) imu->update();
+
+        int periods = bus->timer.wait();
+        if (periods == 0) continue;
+        if (periods < 0) {
+            std::cerr << "Error: Fallo la espera del temporizador del bus " << bus->path << ".\n";
+            break;
+        }
+        bus->overruns.store(bus->timer.getOverruns(), std::memory_order_relaxed);
+    }
+}
+
+} // namespace pimu
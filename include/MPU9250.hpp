@@ -7,12 +7,18 @@ Creditos: https://github.com/ranranff/mpu9250/
 #include "Writer.hpp"
 #include "operations.hpp"
 #include "I2Cdev.hpp"
+#include "I2CBus.hpp"
 #include "LowPass.hpp"
 #include "delay.hpp"
+#include "type.hpp"
 #endif
 
+#include <atomic>
 #include <string>
 #include <cmath>
+#include <mutex>
+#include <stdexcept>
+#include <time.h>
 
 /*
 MPU9250.h
@@ -83,11 +89,11 @@ public:
         LP_ACCEL_ODR_500HZ = 11
     };
 
-    MPU9250() {}
+    MPU9250(const std::string &bus = "/dev/i2c-1", uint8_t address = 0x68) : _bus(bus), _address(address), _i2c(I2CBus::get(bus)) {}
 
     int begin();
     int writeRegister(uint8_t subAddress, uint8_t data);
-    int readRegisters(uint8_t subAddress, uint8_t count, uint8_t* dest);
+    int readRegisters(uint8_t subAddress, uint8_t count, uint8_t* dest, I2CBus::Priority priority = I2CBus::LOW);
 
     int setAccelRange(AccelRange range);
     int setGyroRange(GyroRange range);
@@ -99,6 +105,15 @@ public:
     int enableWakeOnMotion(float womThresh_mg,LpAccelOdr odr);
     
     int readSensor();
+    int readSensor(bool force);
+    void setFreshness(int64_t freshness_ns);
+    SensorFrame getFrame();
+    Sensor getGyro_rads(const SensorFrame &frame);
+    Sensor getAccel_mss(const SensorFrame &frame);
+    void getFrameScales(float *scale, float *offset);
+    void getAxisTransform(int8_t transform[3][3]);
+    uint64_t getBusReads();
+    uint64_t getCacheHits();
     float getGyroX_rads();
     float getGyroY_rads();
     float getGyroZ_rads();
@@ -109,10 +124,15 @@ public:
     float getMagY_uT();
     float getMagZ_uT();
     float getTemperature_C();
+    const std::string &getBus();
+    uint8_t getAddress();
+    I2CBus &getI2CBus();
 protected:
 
     // i2c
-    uint8_t _address = 0x68; // I2C address
+    std::string _bus = "/dev/i2c-1"; // I2C bus device file
+    uint8_t _address = 0x68; // I2C address, 0x69 with AD0 high
+    I2CBus &_i2c; // shared by every device on _bus, serializes the transactions
 
     const uint32_t _i2cRate = 400000; // 400 kHz
     size_t _numBytes = 0; // number of bytes received from I2C
@@ -125,8 +145,14 @@ protected:
     const uint32_t SPI_HS_CLOCK = 15000000; // 15 MHz
     // track success of interacting with Sensor
     int _status = 0;
-    // buffer for reading from Sensor
-    uint8_t _buffer[21];
+    // readSensor() output, the getters may run on another thread than the reads
+    std::mutex _dataMutex;
+    // read coalescing: the last frame is served until it is older than _freshnessNs
+    std::mutex _readMutex;
+    SensorFrame _frame = {};
+    int64_t _freshnessNs = 500000;
+    std::atomic<uint64_t> _busReads{0};
+    std::atomic<uint64_t> _cacheHits{0};
     // data counts
     int16_t _axcounts = 0;
     int16_t _aycounts = 0;
@@ -308,25 +334,29 @@ protected: // private functions
     /* gets the MPU9250 WHO_AM_I register value, expected to be 0x71 */
     int whoAmI(){
         // read the WHO AM I register
-        if (readRegisters(WHO_AM_I,1,_buffer) < 0) {
+        uint8_t buffer[1] = {};
+        if (readRegisters(WHO_AM_I,1,buffer) < 0) {
             return -1;
         }
         // return the register value
-        return _buffer[0];
+        return buffer[0];
     }
     
     /* gets the AK8963 WHO_AM_I register value, expected to be 0x48 */
     int whoAmIAK8963(){
         // read the WHO AM I register
-        if (readAK8963Registers(AK8963_WHO_AM_I,1,_buffer) < 0) {
+        uint8_t buffer[1] = {};
+        if (readAK8963Registers(AK8963_WHO_AM_I,1,buffer) < 0) {
             return -1;
         }
         // return the register value
-        return _buffer[0];
+        return buffer[0];
     }
     
     /* writes a register to the AK8963 given a register address and data */
     int writeAK8963Register(uint8_t subAddress, uint8_t data){
+        // the whole sequence holds the bus, a sensor read in between would find SLV0 pointed at this register
+        I2CBus::Lock lock(_i2c, I2CBus::LOW);
         // set slave 0 to the AK8963 and set for write
         if (writeRegister(I2C_SLV0_ADDR,AK8963_I2C_ADDR) < 0) {
             std::cerr<<__FILE__<<__LINE__<<": error."<<std::endl;
@@ -349,12 +379,13 @@ protected: // private functions
         }
     
         // read the register and confirm
-        if (readAK8963Registers(subAddress,1,_buffer) < 0) {
+        uint8_t buffer[1] = {};
+        if (readAK8963Registers(subAddress,1,buffer) < 0) {
             std::cerr<<__FILE__<<__LINE__<<": error."<<std::endl;
             return -5;
         }
     
-        if(_buffer[0] == data) {
+        if(buffer[0] == data) {
             return 1;
         } else{
             return -6;
@@ -363,6 +394,8 @@ protected: // private functions
     
     /* reads registers from the AK8963 */
     int readAK8963Registers(uint8_t subAddress, uint8_t count, uint8_t* dest){
+        // held until EXT_SENS_DATA is read, see writeAK8963Register()
+        I2CBus::Lock lock(_i2c, I2CBus::LOW);
         // set slave 0 to the AK8963 and set for read
         if (writeRegister(I2C_SLV0_ADDR,AK8963_I2C_ADDR | I2C_READ_FLAG) < 0) {
             return -1;
@@ -468,10 +501,11 @@ int MPU9250::begin(){
     }
     delay(100); // long wait between AK8963 mode changes
     // read the AK8963 ASA registers and compute magnetometer scale factors
-    readAK8963Registers(AK8963_ASA,3,_buffer);
-    _magScaleX = ((((float)_buffer[0]) - 128.0f)/(256.0f) + 1.0f) * 4912.0f / 32760.0f; // micro Tesla
-    _magScaleY = ((((float)_buffer[1]) - 128.0f)/(256.0f) + 1.0f) * 4912.0f / 32760.0f; // micro Tesla
-    _magScaleZ = ((((float)_buffer[2]) - 128.0f)/(256.0f) + 1.0f) * 4912.0f / 32760.0f; // micro Tesla
+    uint8_t buffer[7] = {};
+    readAK8963Registers(AK8963_ASA,3,buffer);
+    _magScaleX = ((((float)buffer[0]) - 128.0f)/(256.0f) + 1.0f) * 4912.0f / 32760.0f; // micro Tesla
+    _magScaleY = ((((float)buffer[1]) - 128.0f)/(256.0f) + 1.0f) * 4912.0f / 32760.0f; // micro Tesla
+    _magScaleZ = ((((float)buffer[2]) - 128.0f)/(256.0f) + 1.0f) * 4912.0f / 32760.0f; // micro Tesla
     // std::cout<<__FILE__<<__LINE__<<"  "<<_magScaleX<<"\t"<<_magScaleY<<"\t"<<_magScaleZ<<"\n";
     // set AK8963 to Power Down
     if(writeAK8963Register(AK8963_CNTL1,AK8963_PWR_DOWN) < 0){
@@ -488,7 +522,7 @@ int MPU9250::begin(){
         return -19;
     }
     // instruct the MPU9250 to get 7 bytes of data from the AK8963 at the sample rate
-    readAK8963Registers(AK8963_HXL,7,_buffer);
+    readAK8963Registers(AK8963_HXL,7,buffer);
 
 
     // set gyro and accel range, bandwidth, and srd
@@ -514,15 +548,16 @@ int MPU9250::begin(){
 /* writes a byte to MPU9250 register given a register address and data */
 int MPU9250::writeRegister(uint8_t subAddress, uint8_t data){
 
-    writeByte(_address, subAddress, data);
+    _i2c.write(_address, subAddress, 1, &data, I2CBus::LOW);
 
     delay(10); // wiringPi delay
 
     /* read back the register */
-    readRegisters(subAddress, 1, _buffer);
+    uint8_t buffer[1] = {static_cast<uint8_t>(~data)};
+    readRegisters(subAddress, 1, buffer);
     /* check the read back register against the written register */
 
-    if(_buffer[0] == data) {
+    if(buffer[0] == data) {
         return 1;
     }
     else{
@@ -530,9 +565,12 @@ int MPU9250::writeRegister(uint8_t subAddress, uint8_t data){
     }
 }
 
-/* reads registers from MPU9250 given a starting register address, number of bytes, and a pointer to store data */
-int MPU9250::readRegisters(uint8_t subAddress, uint8_t count, uint8_t* dest){
-    if ( count == readBytes(_address, subAddress, count, dest)){
+/*
+    reads registers from MPU9250 given a starting register address, number of bytes, and a pointer to store data
+    obs: sensor data reads use I2CBus::HIGH so they go before configuration traffic of other threads
+*/
+int MPU9250::readRegisters(uint8_t subAddress, uint8_t count, uint8_t* dest, I2CBus::Priority priority){
+    if ( count == _i2c.read(_address, subAddress, count, dest, priority)){
         return 0;
     }
     else {
@@ -712,7 +750,8 @@ int MPU9250::setSrd(uint8_t srd) {
         }
         delay(100); // long wait between AK8963 mode changes
         // instruct the MPU9250 to get 7 bytes of data from the AK8963 at the sample rate
-        readAK8963Registers(AK8963_HXL,7,_buffer);
+        uint8_t buffer[7] = {};
+        readAK8963Registers(AK8963_HXL,7,buffer);
     } else {
         // set AK8963 to Power Down
         if(writeAK8963Register(AK8963_CNTL1,AK8963_PWR_DOWN) < 0){
@@ -727,7 +766,8 @@ int MPU9250::setSrd(uint8_t srd) {
         }
         delay(100); // long wait between AK8963 mode changes
         // instruct the MPU9250 to get 7 bytes of data from the AK8963 at the sample rate
-        readAK8963Registers(AK8963_HXL,7,_buffer);
+        uint8_t buffer[7] = {};
+        readAK8963Registers(AK8963_HXL,7,buffer);
     }
     /* setting the sample rate divider */
     if(writeRegister(SMPDIV,srd) < 0){ // setting the sample rate divider
@@ -800,24 +840,60 @@ int MPU9250::enableWakeOnMotion(float womThresh_mg,LpAccelOdr odr) {
     return 1;
 }
 
-/* reads the most current data from MPU9250 and stores in buffer */
+/*
+    reads the most current data from MPU9250 and stores in buffer
+    obs: if the last frame is younger than the freshness deadline (see setFreshness()) it is kept and no bus read is done,
+    so gyro, accel and angle getters of one loop iteration share a single read
+*/
 int MPU9250::readSensor() {
+    return readSensor(false);
+}
+
+/* same as readSensor(), force = true always reads the bus */
+int MPU9250::readSensor(bool force) {
+    // one reader at a time, a reader that waited here finds the frame the other one just read
+    std::lock_guard<std::mutex> read_lock(_readMutex);
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    int64_t now_ns = static_cast<int64_t>(now.tv_sec) * 1000000000LL + now.tv_nsec;
+    if (!force && _frame.seq > 0 && now_ns - _frame.timestamp_ns < _freshnessNs) {
+        _cacheHits.fetch_add(1, std::memory_order_relaxed);
+        return 1;
+    }
+
     _useSPIHS = true; // use the high speed SPI for data readout
     // grab the data from the MPU9250
-    if (readRegisters(ACCEL_OUT, 21, _buffer) < 0) {
+    uint8_t buffer[21];
+    if (readRegisters(ACCEL_OUT, 21, buffer, I2CBus::HIGH) < 0) {
         return -1;
     }
+    _busReads.fetch_add(1, std::memory_order_relaxed);
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    std::lock_guard<std::mutex> lock(_dataMutex);
     // combine into 16 bit values
-    _axcounts = (((int16_t)_buffer[0]) << 8) | _buffer[1];
-    _aycounts = (((int16_t)_buffer[2]) << 8) | _buffer[3];
-    _azcounts = (((int16_t)_buffer[4]) << 8) | _buffer[5];
-    _tcounts  = (((int16_t)_buffer[6]) << 8) | _buffer[7];
-    _gxcounts = (((int16_t)_buffer[8]) << 8) | _buffer[9];
-    _gycounts = (((int16_t)_buffer[10]) << 8) | _buffer[11];
-    _gzcounts = (((int16_t)_buffer[12]) << 8) | _buffer[13];
-    _hxcounts = (((int16_t)_buffer[15]) << 8) | _buffer[14];
-    _hycounts = (((int16_t)_buffer[17]) << 8) | _buffer[16];
-    _hzcounts = (((int16_t)_buffer[19]) << 8) | _buffer[18];
+    _axcounts = (((int16_t)buffer[0]) << 8) | buffer[1];
+    _aycounts = (((int16_t)buffer[2]) << 8) | buffer[3];
+    _azcounts = (((int16_t)buffer[4]) << 8) | buffer[5];
+    _tcounts  = (((int16_t)buffer[6]) << 8) | buffer[7];
+    _gxcounts = (((int16_t)buffer[8]) << 8) | buffer[9];
+    _gycounts = (((int16_t)buffer[10]) << 8) | buffer[11];
+    _gzcounts = (((int16_t)buffer[12]) << 8) | buffer[13];
+    _hxcounts = (((int16_t)buffer[15]) << 8) | buffer[14];
+    _hycounts = (((int16_t)buffer[17]) << 8) | buffer[16];
+    _hzcounts = (((int16_t)buffer[19]) << 8) | buffer[18];
+    _frame.timestamp_ns = static_cast<int64_t>(now.tv_sec) * 1000000000LL + now.tv_nsec;
+    _frame.seq++;
+    _frame.ax = _axcounts;
+    _frame.ay = _aycounts;
+    _frame.az = _azcounts;
+    _frame.temp = _tcounts;
+    _frame.gx = _gxcounts;
+    _frame.gy = _gycounts;
+    _frame.gz = _gzcounts;
+    _frame.hx = _hxcounts;
+    _frame.hy = _hycounts;
+    _frame.hz = _hzcounts;
 
     // transform and convert to float values
     _ax = ((float)(tX[0]*_axcounts + tX[1]*_aycounts + tX[2]*_azcounts) * _accelScale);
@@ -835,54 +911,156 @@ int MPU9250::readSensor() {
 
 /* returns the gyroscope measurement in the x direction, rad/s */
 float MPU9250::getGyroX_rads() {
+    std::lock_guard<std::mutex> lock(_dataMutex);
     return _gx;
 }
 
 /* returns the gyroscope measurement in the y direction, rad/s */
 float MPU9250::getGyroY_rads() {
+    std::lock_guard<std::mutex> lock(_dataMutex);
     return _gy;
 }
 
 /* returns the gyroscope measurement in the z direction, rad/s */
 float MPU9250::getGyroZ_rads() {
+    std::lock_guard<std::mutex> lock(_dataMutex);
     return _gz;
 }
 
 /* returns the accelerometer measurement in the x direction, m/s/s */
 float MPU9250::getAccelX_mss() {
+    std::lock_guard<std::mutex> lock(_dataMutex);
     return _ax;
 }
 
 /* returns the accelerometer measurement in the y direction, m/s/s */
 float MPU9250::getAccelY_mss() {
+    std::lock_guard<std::mutex> lock(_dataMutex);
     return _ay;
 }
 
 /* returns the accelerometer measurement in the z direction, m/s/s */
 float MPU9250::getAccelZ_mss() {
+    std::lock_guard<std::mutex> lock(_dataMutex);
     return _az;
 }
 
 /* returns the magnetometer measurement in the x direction, uT */
 float MPU9250::getMagX_uT() {
+    std::lock_guard<std::mutex> lock(_dataMutex);
     return _hx;
 }
 
 /* returns the magnetometer measurement in the y direction, uT */
 float MPU9250::getMagY_uT() {
+    std::lock_guard<std::mutex> lock(_dataMutex);
     return _hy;
 }
 
 /* returns the magnetometer measurement in the z direction, uT */
 float MPU9250::getMagZ_uT() {
+    std::lock_guard<std::mutex> lock(_dataMutex);
     return _hz;
 }
 
 /* returns the die temperature, C */
 float MPU9250::getTemperature_C() {
+    std::lock_guard<std::mutex> lock(_dataMutex);
     return _t;
 }
 
+/* returns the I2C bus device file the sensor is on */
+const std::string &MPU9250::getBus() {
+    return _bus;
+}
+
+/* returns the I2C address of the sensor */
+uint8_t MPU9250::getAddress() {
+    return _address;
+}
+
+/*
+    sets how long a frame is reused by readSensor() before the bus is read again [ns], 0 reads on every call
+    obs: default is 500 us, keep it below the period of the fastest loop reading this module
+*/
+void MPU9250::setFreshness(int64_t freshness_ns) {
+    if (freshness_ns < 0) {
+        throw std::invalid_argument("The freshness deadline must be non negative.");
+    }
+    std::lock_guard<std::mutex> lock(_readMutex);
+    _freshnessNs = freshness_ns;
+}
+
+/* returns the last frame read from the bus with its timestamp and sequence number (seq 0 if nothing was read yet) */
+SensorFrame MPU9250::getFrame() {
+    std::lock_guard<std::mutex> lock(_dataMutex);
+    return _frame;
+}
+
+/* converts the gyro counts of a frame to the axes and units of getGyroX_rads() and friends [rad/s] */
+Sensor MPU9250::getGyro_rads(const SensorFrame &frame) {
+    Sensor gyro;
+    gyro.x = (float)(tX[0]*frame.gx + tX[1]*frame.gy + tX[2]*frame.gz) * _gyroScale;
+    gyro.y = (float)(tY[0]*frame.gx + tY[1]*frame.gy + tY[2]*frame.gz) * _gyroScale;
+    gyro.z = (float)(tZ[0]*frame.gx + tZ[1]*frame.gy + tZ[2]*frame.gz) * _gyroScale;
+    return gyro;
+}
+
+/* converts the accel counts of a frame to the axes and units of getAccelX_mss() and friends [m/s/s] */
+Sensor MPU9250::getAccel_mss(const SensorFrame &frame) {
+    Sensor accel;
+    accel.x = (float)(tX[0]*frame.ax + tX[1]*frame.ay + tX[2]*frame.az) * _accelScale;
+    accel.y = (float)(tY[0]*frame.ax + tY[1]*frame.ay + tY[2]*frame.az) * _accelScale;
+    accel.z = (float)(tZ[0]*frame.ax + tZ[1]*frame.ay + tZ[2]*frame.az) * _accelScale;
+    return accel;
+}
+
+/*
+    fills scale[10] and offset[10] so that value = count * scale + offset for every SensorFrame channel
+    (ax ay az temp gx gy gz hx hy hz), in the units of the getters, magnetometer calibration included
+    obs: accel and gyro are still in register axes, see getAxisTransform()
+*/
+void MPU9250::getFrameScales(float *scale, float *offset) {
+    for (int i = 0; i < 3; i++) {
+        scale[i] = _accelScale;
+        offset[i] = 0.0f;
+        scale[4 + i] = _gyroScale;
+        offset[4 + i] = 0.0f;
+    }
+    scale[3] = 1.0f / _tempScale;
+    offset[3] = _tempOffset - _tempOffset / _tempScale;
+    scale[7] = _magScaleX * _hxs;
+    scale[8] = _magScaleY * _hys;
+    scale[9] = _magScaleZ * _hzs;
+    offset[7] = -_hxb * _hxs;
+    offset[8] = -_hyb * _hys;
+    offset[9] = -_hzb * _hzs;
+}
+
+/* fills the matrix that maps accel and gyro register axes to the axes of the getters (row major) */
+void MPU9250::getAxisTransform(int8_t transform[3][3]) {
+    for (int j = 0; j < 3; j++) {
+        transform[0][j] = static_cast<int8_t>(tX[j]);
+        transform[1][j] = static_cast<int8_t>(tY[j]);
+        transform[2][j] = static_cast<int8_t>(tZ[j]);
+    }
+}
+
+/* returns the number of readSensor() calls that read the bus */
+uint64_t MPU9250::getBusReads() {
+    return _busReads.load(std::memory_order_relaxed);
+}
+
+/* returns the number of readSensor() calls served from the last frame */
+uint64_t MPU9250::getCacheHits() {
+    return _cacheHits.load(std::memory_order_relaxed);
+}
+
+/* returns the manager of the sensor bus, e.g. to check how long reads wait for it (I2CBus::getQueueDelay()) */
+I2CBus &MPU9250::getI2CBus() {
+    return _i2c;
+}
+
 
 
 } // namespace pimu
\ No newline at end of file
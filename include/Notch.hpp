@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <stdexcept>
+
+namespace pimu {
+
+/*
+    adaptive second order notch filter
+    H(z) = c (1 + a z^-1 + z^-2) / (1 + c a z^-1 + r^2 z^-2), with a = -2 cos(w0) and c = (1 + r^2) / 2
+    unity gain away from the notch, the center is tracked with a normalized gradient on the output power
+    or glides towards a frequency given with Notch::setCenterFrequency()
+    obs: setCenterFrequency() and getFrequency() may run on another thread than filter(), setup() may not
+*/
+template<typename T>
+class Notch {
+private:
+    T sample_rate_ = static_cast<T>(0);
+    T radius_ = static_cast<T>(0);     // pole radius, defines the notch width
+    T gain_ = static_cast<T>(0);       // c = (1 + r^2) / 2
+    T a_ = static_cast<T>(0);          // -2 cos(w0)
+    T glide_target_ = static_cast<T>(0);
+    bool gliding_ = false;
+    T a_min_ = static_cast<T>(-2);
+    T a_max_ = static_cast<T>(2);
+    T mu_ = static_cast<T>(0);         // adaptation rate, 0 disables tracking
+    T glide_ = static_cast<T>(0.01);   // fraction of the distance to a_target_ covered per sample
+    T power_ = static_cast<T>(0);      // power estimate for the gradient normalization
+    T s1_ = static_cast<T>(0);
+    T s2_ = static_cast<T>(0);
+    bool enabled_ = false;
+
+    // handoff from setCenterFrequency(), the target is stored before the flag is released
+    std::atomic<T> a_target_{static_cast<T>(0)};
+    std::atomic<bool> retune_pending_{false};
+    std::atomic<T> a_published_{static_cast<T>(0)}; // a_ for getFrequency()
+
+    const T kMaxStep = static_cast<T>(0.005);
+
+    T frequencyToCoefficient(T frequency_hz);
+
+public:
+    Notch();
+
+    void setup(T sample_rate_hz, T bandwidth_hz, T min_hz, T max_hz);
+    void setAdaptationRate(T rate);
+    void setCenterFrequency(T frequency_hz);
+    bool isEnabled();
+    T getFrequency();
+    T filter(T input);
+};
+
+/* Constructor: the filter is a pass-through until Notch::setup() is called */
+template<typename T>
+Notch<T>::Notch() {}
+
+/* sets sample rate, -3 dB notch width and tracking range [Hz], the notch starts at the middle of the range */
+template<typename T>
+void Notch<T>::setup(T sample_rate_hz, T bandwidth_hz, T min_hz, T max_hz) {
+    const T pi = static_cast<T>(3.14159265358979323846);
+    T nyquist = sample_rate_hz / static_cast<T>(2);
+    if (sample_rate_hz <= static_cast<T>(0) || bandwidth_hz <= static_cast<T>(0) || bandwidth_hz >= nyquist) {
+        throw std::invalid_argument("The notch bandwidth must be in the range (0, sample_rate / 2).");
+    }
+    if (min_hz <= static_cast<T>(0) || max_hz >= nyquist || min_hz >= max_hz) {
+        throw std::invalid_argument("The notch range must be inside (0, sample_rate / 2).");
+    }
+
+    sample_rate_ = sample_rate_hz;
+    radius_ = static_cast<T>(1) - pi * bandwidth_hz / sample_rate_hz;
+    gain_ = (static_cast<T>(1) + radius_ * radius_) / static_cast<T>(2);
+    a_min_ = frequencyToCoefficient(min_hz);
+    a_max_ = frequencyToCoefficient(max_hz);
+    a_ = glide_target_ = frequencyToCoefficient((min_hz + max_hz) / static_cast<T>(2));
+    a_target_.store(a_, std::memory_order_relaxed);
+    a_published_.store(a_, std::memory_order_relaxed);
+    gliding_ = false;
+    retune_pending_.store(false, std::memory_order_relaxed);
+    power_ = s1_ = s2_ = static_cast<T>(0);
+    enabled_ = true;
+}
+
+/* sets the normalized gradient step used to follow the dominant frequency, 0 keeps the notch fixed */
+template<typename T>
+void Notch<T>::setAdaptationRate(T rate) {
+    if (rate < static_cast<T>(0) || rate > static_cast<T>(1)) {
+        throw std::invalid_argument("The adaptation rate must be in the range [0,1].");
+    }
+    mu_ = rate;
+}
+
+/* retunes the notch towards frequency_hz (e.g. an FFT peak), the coefficients glide to it over a few hundred samples */
+template<typename T>
+void Notch<T>::setCenterFrequency(T frequency_hz) {
+    a_target_.store(std::min(std::max(frequencyToCoefficient(frequency_hz), a_min_), a_max_), std::memory_order_relaxed);
+    retune_pending_.store(true, std::memory_order_release);
+}
+
+/* checks if the filter has been configured */
+template<typename T>
+bool Notch<T>::isEnabled() {
+    return enabled_;
+}
+
+/* returns the current notch frequency [Hz] */
+template<typename T>
+T Notch<T>::getFrequency() {
+    const T pi = static_cast<T>(3.14159265358979323846);
+    return std::acos(-a_published_.load(std::memory_order_relaxed) / static_cast<T>(2)) * sample_rate_ / (static_cast<T>(2) * pi);
+}
+
+/* removes the tracked frequency from the input */
+template<typename T>
+T Notch<T>::filter(T input) {
+    if (!enabled_) return input;
+
+    T r2 = radius_ * radius_;
+    T s = input - gain_ * a_ * s1_ - r2 * s2_;
+    T output = gain_ * (s + a_ * s1_ + s2_);
+
+    if (mu_ > static_cast<T>(0)) {
+        // d(output)/da ~ c * s1, normalized by the power of s1
+        power_ = static_cast<T>(0.99) * power_ + static_cast<T>(0.01) * s1_ * s1_;
+        T step = mu_ * output * s1_ / (power_ + static_cast<T>(1e-12));
+        // bounded step, the power estimate is unreliable right after start up or a transient
+        a_ -= std::min(std::max(step, -kMaxStep), kMaxStep);
+    }
+    // taking the flag before reading the target, a newer retune sets it again for the next sample
+    if (retune_pending_.load(std::memory_order_relaxed) && retune_pending_.exchange(false, std::memory_order_acquire)) {
+        glide_target_ = a_target_.load(std::memory_order_relaxed);
+        gliding_ = true;
+    }
+    if (gliding_) {
+        a_ += glide_ * (glide_target_ - a_);
+        gliding_ = std::abs(glide_target_ - a_) > static_cast<T>(1e-4);
+    }
+    a_ = std::min(std::max(a_, a_min_), a_max_);
+    a_published_.store(a_, std::memory_order_relaxed);
+
+    s2_ = s1_;
+    s1_ = s;
+    return output;
+}
+
+/* a = -2 cos(2 pi f / fs) */
+template<typename T>
+T Notch<T>::frequencyToCoefficient(T frequency_hz) {
+    const T pi = static_cast<T>(3.14159265358979323846);
+    return static_cast<T>(-2) * std::cos(static_cast<T>(2) * pi * frequency_hz / sample_rate_);
+}
+
+} // namespace pimu
@@ -0,0 +1,167 @@
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <ctime>
+#include <stdexcept>
+
+namespace pimu {
+
+/*
+    periodic wakeups on absolute CLOCK_MONOTONIC deadlines (timerfd)
+    deadline k is start + k * period, so the rate does not drift with the work done between waits,
+    missed deadlines are counted as overruns and skipped instead of being run back to back
+*/
+class PeriodicTimer {
+public:
+    PeriodicTimer();
+    ~PeriodicTimer();
+
+    void start(double rate_hz);
+    void setRate(double rate_hz);
+    int wait();
+    int acknowledge();
+    void interrupt();
+    int getFd();
+    uint64_t getOverruns();
+    int64_t getLastLateness();
+    int64_t getLastDeadline();
+
+    static int64_t now();
+
+private:
+    int timer_fd_ = -1;
+    int event_fd_ = -1;         // written by PeriodicTimer::interrupt()
+    int64_t period_ns_ = 0;
+    int64_t deadline_ns_ = 0;   // last deadline returned by PeriodicTimer::wait()
+    int64_t lateness_ns_ = 0;
+    uint64_t overruns_ = 0;
+
+    void arm(int64_t first_deadline_ns);
+};
+
+/* Constructor: the timer is idle until PeriodicTimer::start() */
+PeriodicTimer::PeriodicTimer() {
+    timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    event_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (timer_fd_ < 0 || event_fd_ < 0) {
+        if (timer_fd_ >= 0) close(timer_fd_);
+        if (event_fd_ >= 0) close(event_fd_);
+        throw std::runtime_error("Failed to create the periodic timer.");
+    }
+}
+
+/* Destructor */
+PeriodicTimer::~PeriodicTimer() {
+    close(timer_fd_);
+    close(event_fd_);
+}
+
+/* first deadline one period from now, clears overruns and pending interrupts */
+void PeriodicTimer::start(double rate_hz) {
+    if (rate_hz <= 0.0) {
+        throw std::invalid_argument("The timer rate must be positive.");
+    }
+    uint64_t pending;
+    while (read(event_fd_, &pending, sizeof(pending)) == sizeof(pending)) {}
+
+    period_ns_ = static_cast<int64_t>(std::llround(1e9 / rate_hz));
+    overruns_ = 0;
+    lateness_ns_ = 0;
+    deadline_ns_ = now();
+    arm(deadline_ns_ + period_ns_);
+}
+
+/* changes the period, the new one starts counting from the last deadline so the phase is kept */
+void PeriodicTimer::setRate(double rate_hz) {
+    if (rate_hz <= 0.0) {
+        throw std::invalid_argument("The timer rate must be positive.");
+    }
+    period_ns_ = static_cast<int64_t>(std::llround(1e9 / rate_hz));
+    arm(deadline_ns_ + period_ns_);
+}
+
+/*
+    sleeps until the next deadline, returns the number of periods elapsed since the previous one
+    (1 on time, more than 1 if deadlines were missed), 0 if PeriodicTimer::interrupt() was called, -1 on error
+*/
+int PeriodicTimer::wait() {
+    struct pollfd fds[2];
+    fds[0].fd = timer_fd_;
+    fds[0].events = POLLIN;
+    fds[1].fd = event_fd_;
+    fds[1].events = POLLIN;
+
+    while (true) {
+        int ready = poll(fds, 2, -1);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (fds[1].revents & POLLIN) {
+            uint64_t pending;
+            while (read(event_fd_, &pending, sizeof(pending)) == sizeof(pending)) {}
+            return 0;
+        }
+        if (fds[0].revents & POLLIN) break;
+    }
+    return acknowledge();
+}
+
+/*
+    takes the expirations of a timer that is ready, for event loops that poll PeriodicTimer::getFd() themselves
+    returns the number of periods elapsed like PeriodicTimer::wait(), blocks if no deadline has passed
+*/
+int PeriodicTimer::acknowledge() {
+    uint64_t expirations = 0;
+    if (read(timer_fd_, &expirations, sizeof(expirations)) != sizeof(expirations) || expirations == 0) return -1;
+
+    deadline_ns_ += static_cast<int64_t>(expirations) * period_ns_;
+    lateness_ns_ = now() - deadline_ns_;
+    overruns_ += expirations - 1;
+    return static_cast<int>(expirations);
+}
+
+/* wakes up PeriodicTimer::wait() from any thread, a call before the wait makes the next wait return at once */
+void PeriodicTimer::interrupt() {
+    uint64_t one = 1;
+    ssize_t written = write(event_fd_, &one, sizeof(one));
+    (void)written;
+}
+
+/* returns the timer file descriptor, readable when a deadline has passed */
+int PeriodicTimer::getFd() { return timer_fd_; }
+
+/* returns the number of deadlines missed since PeriodicTimer::start() */
+uint64_t PeriodicTimer::getOverruns() { return overruns_; }
+
+/* returns how late the last PeriodicTimer::wait() woke up with respect to its deadline [ns] */
+int64_t PeriodicTimer::getLastLateness() { return lateness_ns_; }
+
+/* returns the deadline the last PeriodicTimer::wait() woke up for, CLOCK_MONOTONIC [ns] */
+int64_t PeriodicTimer::getLastDeadline() { return deadline_ns_; }
+
+/* returns CLOCK_MONOTONIC [ns] */
+int64_t PeriodicTimer::now() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return static_cast<int64_t>(time.tv_sec) * 1000000000LL + time.tv_nsec;
+}
+
+/* periodic absolute expirations starting at first_deadline_ns */
+void PeriodicTimer::arm(int64_t first_deadline_ns) {
+    struct itimerspec spec;
+    spec.it_value.tv_sec = first_deadline_ns / 1000000000LL;
+    spec.it_value.tv_nsec = first_deadline_ns % 1000000000LL;
+    spec.it_interval.tv_sec = period_ns_ / 1000000000LL;
+    spec.it_interval.tv_nsec = period_ns_ % 1000000000LL;
+    if (timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &spec, nullptr) < 0) {
+        throw std::runtime_error("Failed to arm the periodic timer.");
+    }
+}
+
+} // namespace pimu
@@ -0,0 +1,201 @@
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <iostream>
+
+/*
+    loop instrumentation is compiled in by default,
+    build with -DPIMU_NO_PROFILING to remove every timestamp and record from the update path
+*/
+#ifdef PIMU_NO_PROFILING
+#define PIMU_PROFILE_START(name) ((void)0)
+#define PIMU_PROFILE_RECORD(profiler, stage, name) ((void)0)
+#define PIMU_PROFILE_VALUE(profiler, stage, value_ns) ((void)0)
+#else
+#define PIMU_PROFILE_START(name) const int64_t name = pimu::LoopProfiler::now()
+#define PIMU_PROFILE_RECORD(profiler, stage, name) (profiler).record((stage), pimu::LoopProfiler::now() - (name))
+#define PIMU_PROFILE_VALUE(profiler, stage, value_ns) (profiler).record((stage), (value_ns))
+#endif
+
+namespace pimu {
+
+/* summary of a latency histogram [ns], percentiles are the upper edge of their bucket */
+struct LatencyStats
+{
+    uint64_t count;
+    uint64_t p50_ns;
+    uint64_t p99_ns;
+    uint64_t max_ns;
+};
+
+/*
+    fixed bucket log-scale histogram of durations in nanoseconds
+    every power of two is split in 4 buckets (< 25 % relative error), up to ~10^12 ns
+    one writer thread records without locks, any thread can read, no allocation
+*/
+class LatencyHistogram {
+public:
+    static constexpr int kSubBuckets = 4;
+    static constexpr int kBuckets = 160;
+
+    LatencyHistogram();
+
+    void record(int64_t value_ns);
+    void reset();
+    uint64_t getCount();
+    uint64_t getMax();
+    uint64_t getPercentile(double percentile);
+    LatencyStats getStats();
+
+private:
+    std::atomic<uint64_t> buckets_[kBuckets];
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> max_{0};
+
+    static int bucketOf(uint64_t value);
+    static uint64_t upperEdge(int bucket);
+};
+
+/* Constructor: starts empty */
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+/* adds one duration, negative values count as 0, writer thread only */
+inline void LatencyHistogram::record(int64_t value_ns) {
+    uint64_t value = value_ns > 0 ? static_cast<uint64_t>(value_ns) : 0;
+    // single writer, a plain load and store is enough and avoids a read-modify-write
+    std::atomic<uint64_t> &bucket = buckets_[bucketOf(value)];
+    bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if (value > max_.load(std::memory_order_relaxed)) max_.store(value, std::memory_order_relaxed);
+    count_.store(count_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+/* discards every value, a record running at the same time may survive the reset */
+void LatencyHistogram::reset() {
+    for (int i = 0; i < kBuckets; i++) buckets_[i].store(0, std::memory_order_relaxed);
+    count_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+/* returns the number of recorded values */
+uint64_t LatencyHistogram::getCount() { return count_.load(std::memory_order_relaxed); }
+
+/* returns the largest recorded value [ns] */
+uint64_t LatencyHistogram::getMax() { return max_.load(std::memory_order_relaxed); }
+
+/* returns the value below which percentile (0,1] of the records fall [ns] */
+uint64_t LatencyHistogram::getPercentile(double percentile) {
+    uint64_t counts[kBuckets];
+    uint64_t total = 0;
+    for (int i = 0; i < kBuckets; i++) {
+        counts[i] = buckets_[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    if (total == 0) return 0;
+
+    uint64_t target = static_cast<uint64_t>(percentile * total + 0.5);
+    if (target < 1) target = 1;
+    uint64_t max = getMax();
+    uint64_t cumulative = 0;
+    for (int i = 0; i < kBuckets; i++) {
+        cumulative += counts[i];
+        if (cumulative >= target) {
+            uint64_t edge = upperEdge(i);
+            return edge < max ? edge : max;
+        }
+    }
+    return max;
+}
+
+/* returns count, p50, p99 and max */
+LatencyStats LatencyHistogram::getStats() {
+    LatencyStats stats;
+    stats.count = getCount();
+    stats.p50_ns = getPercentile(0.50);
+    stats.p99_ns = getPercentile(0.99);
+    stats.max_ns = getMax();
+    return stats;
+}
+
+/* 0..3 are exact, then 4 buckets per power of two */
+inline int LatencyHistogram::bucketOf(uint64_t value) {
+    if (value < kSubBuckets) return static_cast<int>(value);
+    int msb = 63 - __builtin_clzll(value);
+    int bucket = (msb - 1) * kSubBuckets + static_cast<int>((value >> (msb - 2)) & (kSubBuckets - 1));
+    return bucket < kBuckets ? bucket : kBuckets - 1;
+}
+
+/* largest value that falls in a bucket */
+uint64_t LatencyHistogram::upperEdge(int bucket) {
+    if (bucket < kSubBuckets) return static_cast<uint64_t>(bucket);
+    int msb = bucket / kSubBuckets + 1;
+    uint64_t sub = static_cast<uint64_t>(bucket % kSubBuckets);
+    return ((kSubBuckets + sub + 1) << (msb - 2)) - 1;
+}
+
+/* per stage durations of the update loop */
+class LoopProfiler {
+public:
+    enum Stage {
+        READ,       // sensor bus read
+        FILTER,     // spike, notch and low pass filters
+        ANGLES,     // angle integration
+        PUBLISH,    // gravity removal, snapshot and sample ring
+        CONSUMERS,  // dead reckoning and spectrum
+        UPDATE,     // whole Imu::update()
+        WAKEUP,     // lateness of the periodic wakeup
+        NUM_STAGES
+    };
+
+    void record(Stage stage, int64_t value_ns);
+    LatencyStats getStats(Stage stage);
+    void reset();
+    void print();
+
+    static const char *getStageName(Stage stage);
+    static int64_t now();
+
+private:
+    LatencyHistogram histograms_[NUM_STAGES];
+};
+
+/* adds one duration to a stage, writer thread only */
+inline void LoopProfiler::record(Stage stage, int64_t value_ns) {
+    histograms_[stage].record(value_ns);
+}
+
+/* returns count, p50, p99 and max of a stage [ns] */
+LatencyStats LoopProfiler::getStats(Stage stage) {
+    return histograms_[stage].getStats();
+}
+
+/* discards every stage */
+void LoopProfiler::reset() {
+    for (int i = 0; i < NUM_STAGES; i++) histograms_[i].reset();
+}
+
+/* prints one line per stage in microseconds */
+void LoopProfiler::print() {
+    for (int i = 0; i < NUM_STAGES; i++) {
+        LatencyStats stats = histograms_[i].getStats();
+        std::cout << getStageName(static_cast<Stage>(i)) << ": n " << stats.count
+                  << ", p50 " << stats.p50_ns / 1000.0 << " us, p99 " << stats.p99_ns / 1000.0
+                  << " us, max " << stats.max_ns / 1000.0 << " us\n";
+    }
+}
+
+/* returns the name of a stage */
+const char *LoopProfiler::getStageName(Stage stage) {
+    static const char *names[NUM_STAGES] = {"read", "filter", "angles", "publish", "consumers", "update", "wakeup"};
+    return names[stage];
+}
+
+/* returns CLOCK_MONOTONIC [ns] */
+inline int64_t LoopProfiler::now() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return static_cast<int64_t>(time.tv_sec) * 1000000000LL + time.tv_nsec;
+}
+
+} // namespace pimu
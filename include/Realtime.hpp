@@ -0,0 +1,197 @@
+#include <alloca.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+namespace pimu {
+
+/* scheduling options for an acquisition thread, the defaults leave the thread as created */
+struct RealtimeOptions
+{
+    /* SCHED_FIFO priority [1,99], 0 keeps the default (SCHED_OTHER) policy */
+    int priority = 0;
+
+    /* cpu the thread is pinned to, -1 lets the scheduler move it */
+    int cpu = -1;
+
+    /*
+        locks current and future pages of the process in memory (mlockall)
+        obs: a BinaryLogWriter keeps the part of its file it is not writing inaccessible, so it is not read in and pinned
+    */
+    bool lock_memory = false;
+
+    /*
+        stack touched at start so the loop never page faults on it [bytes], limited to the free stack of the thread
+        obs: with this or lock_memory the loop also touches the buffers of its Imus, see Imu::prefaultBuffers()
+    */
+    size_t prefault_stack_bytes = 0;
+};
+
+/* wakeup lateness of a periodic loop, measured against its deadlines [us] */
+struct JitterReport
+{
+    uint64_t samples;
+    double mean_us;
+    double std_us;
+    double min_us;
+    double max_us;
+};
+
+/*
+    applies RealtimeOptions to the calling thread
+    every option is independent, an option that fails (usually missing CAP_SYS_NICE or RLIMIT_MEMLOCK)
+    prints a warning and the rest are still applied, returns the number of options that could not be applied
+*/
+int applyRealtimeOptions(const RealtimeOptions &options) {
+    int failed = 0;
+
+    // memory is locked first so the prefaulted stack stays resident
+    if (options.lock_memory) {
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+            std::cerr << "Advertencia: No se pudo bloquear la memoria (mlockall): " << strerror(errno) << "\n";
+            failed++;
+        }
+    }
+
+    if (options.prefault_stack_bytes > 0) {
+        // only the stack left below this frame can be touched, minus a margin for the calls made from here
+        const size_t kStackMargin = 64 * 1024;
+        size_t bytes = options.prefault_stack_bytes;
+        pthread_attr_t attr;
+        if (pthread_getattr_np(pthread_self(), &attr) == 0) {
+            void *stack_low = nullptr;
+            size_t stack_size = 0;
+            pthread_attr_getstack(&attr, &stack_low, &stack_size);
+            pthread_attr_destroy(&attr);
+            unsigned char here;
+            size_t free_bytes = static_cast<size_t>(&here - static_cast<unsigned char *>(stack_low));
+            size_t limit = free_bytes > kStackMargin ? free_bytes - kStackMargin : 0;
+            if (bytes > limit) {
+                std::cerr << "Advertencia: Solo se pueden precargar " << limit << " bytes de pila.\n";
+                bytes = limit;
+                failed++;
+            }
+        } else {
+            std::cerr << "Advertencia: No se pudo leer el tamaño de la pila, no se precarga.\n";
+            bytes = 0;
+            failed++;
+        }
+
+        // touches one byte per page below the current frame
+        if (bytes > 0) {
+            size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+            volatile unsigned char *stack = static_cast<volatile unsigned char *>(alloca(bytes));
+            for (size_t i = 0; i < bytes; i += page) stack[i] = 0;
+        }
+    }
+
+    if (options.cpu >= CPU_SETSIZE) {
+        std::cerr << "Advertencia: La cpu " << options.cpu << " esta fuera del rango (0 a " << CPU_SETSIZE - 1 << ").\n";
+        failed++;
+    } else if (options.cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(options.cpu, &set);
+        int error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (error != 0) {
+            std::cerr << "Advertencia: No se pudo fijar el hilo a la cpu " << options.cpu << ": " << strerror(error) << "\n";
+            failed++;
+        }
+    }
+
+    if (options.priority > 0) {
+        struct sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = std::min(options.priority, sched_get_priority_max(SCHED_FIFO));
+        int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (error != 0) {
+            std::cerr << "Advertencia: No se pudo usar SCHED_FIFO con prioridad " << param.sched_priority
+                      << ": " << strerror(error) << "\n";
+            failed++;
+        }
+    }
+
+    return failed;
+}
+
+/* reads one byte of every page of a buffer, brings back the pages that were swapped out before a loop uses them */
+void prefaultMemory(const void *address, size_t bytes) {
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const volatile unsigned char *memory = static_cast<const volatile unsigned char *>(address);
+    for (size_t i = 0; i < bytes; i += page) (void)memory[i];
+    if (bytes > 0) (void)memory[bytes - 1];
+}
+
+/* accumulates wakeup lateness, owned by the loop thread */
+class JitterMeter {
+public:
+    JitterMeter();
+
+    void reset();
+    void add(int64_t lateness_ns);
+    JitterReport getReport();
+
+    static void print(const JitterReport &report);
+
+private:
+    uint64_t samples_;
+    double sum_;
+    double sum_squares_;
+    int64_t min_;
+    int64_t max_;
+};
+
+/* Constructor: starts empty */
+JitterMeter::JitterMeter() {
+    reset();
+}
+
+/* discards every measurement */
+void JitterMeter::reset() {
+    samples_ = 0;
+    sum_ = sum_squares_ = 0.0;
+    min_ = max_ = 0;
+}
+
+/* adds the difference between the actual wakeup and the deadline [ns] */
+void JitterMeter::add(int64_t lateness_ns) {
+    if (samples_ == 0 || lateness_ns < min_) min_ = lateness_ns;
+    if (samples_ == 0 || lateness_ns > max_) max_ = lateness_ns;
+    double lateness = static_cast<double>(lateness_ns);
+    sum_ += lateness;
+    sum_squares_ += lateness * lateness;
+    samples_++;
+}
+
+/* returns count, mean, standard deviation and extremes of the lateness [us] */
+JitterReport JitterMeter::getReport() {
+    JitterReport report;
+    report.samples = samples_;
+    report.mean_us = report.std_us = report.min_us = report.max_us = 0.0;
+    if (samples_ == 0) return report;
+
+    double mean = sum_ / samples_;
+    double variance = std::max(0.0, sum_squares_ / samples_ - mean * mean);
+    report.mean_us = mean / 1000.0;
+    report.std_us = std::sqrt(variance) / 1000.0;
+    report.min_us = min_ / 1000.0;
+    report.max_us = max_ / 1000.0;
+    return report;
+}
+
+/* prints a jitter report in a single line */
+void JitterMeter::print(const JitterReport &report) {
+    std::cout << "Latencia de despertar (" << report.samples << " muestras): media " << report.mean_us
+              << " us, desv " << report.std_us << " us, min " << report.min_us
+              << " us, max " << report.max_us << " us\n";
+}
+
+} // namespace pimu
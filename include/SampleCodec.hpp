@@ -0,0 +1,285 @@
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace pimu {
+
+/*
+    lossless codec for interleaved int16 channels (e.g. the raw counts of a SensorFrame)
+    block layout, little-endian:
+        u16 sync, u8 channels, u8 version, u16 samples, u32 payload bytes
+        per channel: u8 predictor, i16 first value, then per group of kCodecGroup residuals: u8 bits + packed residuals
+    each block starts from its own first values, so any block decodes without the ones before it
+*/
+const uint16_t kCodecSync = 0x4350; // "PC"
+const uint8_t kCodecVersion = 1;
+const size_t kCodecHeaderSize = 10;
+const int kCodecGroup = 32;
+
+/* residual predictors, chosen per channel and block, the one that packs smaller wins */
+enum CodecPredictor
+{
+    CODEC_RAW = 0,      // the value itself
+    CODEC_DELTA = 1,    // x[i] - x[i-1]
+    CODEC_SECOND = 2    // x[i] - 2 x[i-1] + x[i-2], for slow signals
+};
+
+/*
+    streaming encoder: push() samples of num_channels values, every block_samples samples a block is encoded
+    obs: one thread, the block returned by getBlock() is valid until the next push() or flush()
+*/
+class SampleEncoder {
+public:
+    SampleEncoder(int num_channels, int block_samples = 256);
+
+    bool push(const int16_t *sample);
+    bool flush();
+    const std::vector<uint8_t> &getBlock();
+    uint64_t getInputBytes();
+    uint64_t getOutputBytes();
+
+private:
+    int num_channels_;
+    int block_samples_;
+    int count_ = 0;
+    std::vector<int16_t> samples_;      // channel major, block_samples_ per channel
+    std::vector<uint32_t> residuals_[3]; // zigzag residuals of one channel for each predictor
+    std::vector<uint8_t> block_;
+    uint64_t input_bytes_ = 0;
+    uint64_t output_bytes_ = 0;
+
+    void encode();
+    void computeResiduals(const int16_t *x);
+    size_t packedSize(const std::vector<uint32_t> &residuals);
+    void pack(const std::vector<uint32_t> &residuals);
+};
+
+/* block decoder, stateless between blocks */
+class SampleDecoder {
+public:
+    size_t decode(const uint8_t *data, size_t size, std::vector<int16_t> &samples);
+    int getNumChannels();
+    int getNumSamples();
+
+private:
+    int num_channels_ = 0;
+    int num_samples_ = 0;
+};
+
+/* maps signed residuals to unsigned so small magnitudes of either sign need few bits */
+inline uint32_t zigzagEncode(int32_t value) {
+    return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+inline int32_t zigzagDecode(uint32_t value) {
+    return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+}
+
+/* number of bits needed to store value */
+inline int bitWidth(uint32_t value) {
+    return value == 0 ? 0 : 32 - __builtin_clz(value);
+}
+
+/* Constructor: block_samples between 2 and 65535 */
+SampleEncoder::SampleEncoder(int num_channels, int block_samples)
+    : num_channels_(num_channels), block_samples_(block_samples) {
+    if (num_channels < 1 || num_channels > 255 || block_samples < 2 || block_samples > 65535) {
+        throw std::invalid_argument("The codec takes 1 to 255 channels and blocks of 2 to 65535 samples.");
+    }
+    samples_.resize(static_cast<size_t>(num_channels) * block_samples);
+    for (std::vector<uint32_t> &residuals : residuals_) residuals.reserve(block_samples);
+    // worst case: 18 bit residuals (second order of a full scale step) plus the group widths
+    size_t groups = (block_samples + kCodecGroup - 1) / kCodecGroup;
+    block_.reserve(kCodecHeaderSize + num_channels * (3 + groups + (18 * block_samples + 7) / 8));
+}
+
+/* adds one sample (num_channels values), returns true when it completed a block, see getBlock() */
+bool SampleEncoder::push(const int16_t *sample) {
+    for (int c = 0; c < num_channels_; c++) samples_[c * block_samples_ + count_] = sample[c];
+    if (++count_ < block_samples_) return false;
+    encode();
+    return true;
+}
+
+/* encodes the samples pushed since the last block as a shorter block, returns false if there were none */
+bool SampleEncoder::flush() {
+    if (count_ == 0) return false;
+    encode();
+    return true;
+}
+
+/* returns the last block encoded */
+const std::vector<uint8_t> &SampleEncoder::getBlock() {
+    return block_;
+}
+
+/* returns the bytes of the samples encoded so far */
+uint64_t SampleEncoder::getInputBytes() {
+    return input_bytes_;
+}
+
+/* returns the bytes of the blocks encoded so far */
+uint64_t SampleEncoder::getOutputBytes() {
+    return output_bytes_;
+}
+
+/* encodes the buffered samples into block_ */
+void SampleEncoder::encode() {
+    block_.clear();
+    block_.resize(kCodecHeaderSize);
+    for (int c = 0; c < num_channels_; c++) {
+        const int16_t *x = &samples_[c * block_samples_];
+        computeResiduals(x);
+
+        int best = CODEC_RAW;
+        size_t best_size = packedSize(residuals_[CODEC_RAW]);
+        for (int p = CODEC_DELTA; p <= CODEC_SECOND; p++) {
+            size_t size = packedSize(residuals_[p]);
+            if (size < best_size) {
+                best = p;
+                best_size = size;
+            }
+        }
+        uint16_t first = static_cast<uint16_t>(x[0]);
+        block_.push_back(static_cast<uint8_t>(best));
+        block_.push_back(static_cast<uint8_t>(first));
+        block_.push_back(static_cast<uint8_t>(first >> 8));
+        pack(residuals_[best]);
+    }
+
+    uint32_t payload = static_cast<uint32_t>(block_.size() - kCodecHeaderSize);
+    uint8_t *header = block_.data();
+    header[0] = static_cast<uint8_t>(kCodecSync);
+    header[1] = static_cast<uint8_t>(kCodecSync >> 8);
+    header[2] = static_cast<uint8_t>(num_channels_);
+    header[3] = kCodecVersion;
+    header[4] = static_cast<uint8_t>(count_);
+    header[5] = static_cast<uint8_t>(count_ >> 8);
+    for (int i = 0; i < 4; i++) header[6 + i] = static_cast<uint8_t>(payload >> (8 * i));
+
+    input_bytes_ += static_cast<uint64_t>(count_) * num_channels_ * sizeof(int16_t);
+    output_bytes_ += block_.size();
+    count_ = 0;
+}
+
+/* residuals of x[1..count_-1] for every predictor, x[0] is stored as it is */
+void SampleEncoder::computeResiduals(const int16_t *x) {
+    for (std::vector<uint32_t> &residuals : residuals_) residuals.resize(count_ - 1);
+    for (int i = 1; i < count_; i++) {
+        int32_t delta = static_cast<int32_t>(x[i]) - x[i - 1];
+        int32_t second = i < 2 ? delta : delta - (static_cast<int32_t>(x[i - 1]) - x[i - 2]);
+        residuals_[CODEC_RAW][i - 1] = zigzagEncode(x[i]);
+        residuals_[CODEC_DELTA][i - 1] = zigzagEncode(delta);
+        residuals_[CODEC_SECOND][i - 1] = zigzagEncode(second);
+    }
+}
+
+/* bytes pack() would append for these residuals */
+size_t SampleEncoder::packedSize(const std::vector<uint32_t> &residuals) {
+    size_t size = 0;
+    for (size_t start = 0; start < residuals.size(); start += kCodecGroup) {
+        size_t end = start + kCodecGroup < residuals.size() ? start + kCodecGroup : residuals.size();
+        uint32_t bits = 0;
+        for (size_t i = start; i < end; i++) bits |= residuals[i];
+        size += 1 + ((end - start) * bitWidth(bits) + 7) / 8;
+    }
+    return size;
+}
+
+/* appends the residuals in groups, each group with its own bit width, least significant bit first */
+void SampleEncoder::pack(const std::vector<uint32_t> &residuals) {
+    for (size_t start = 0; start < residuals.size(); start += kCodecGroup) {
+        size_t end = start + kCodecGroup < residuals.size() ? start + kCodecGroup : residuals.size();
+        uint32_t bits = 0;
+        for (size_t i = start; i < end; i++) bits |= residuals[i];
+        int width = bitWidth(bits);
+        block_.push_back(static_cast<uint8_t>(width));
+
+        uint64_t buffer = 0;
+        int used = 0;
+        for (size_t i = start; i < end && width > 0; i++) {
+            buffer |= static_cast<uint64_t>(residuals[i]) << used;
+            used += width;
+            while (used >= 8) {
+                block_.push_back(static_cast<uint8_t>(buffer));
+                buffer >>= 8;
+                used -= 8;
+            }
+        }
+        if (used > 0) block_.push_back(static_cast<uint8_t>(buffer));
+    }
+}
+
+/*
+    decodes the block at data into samples (interleaved, getNumSamples() x getNumChannels())
+    returns the bytes of the block, 0 if data does not start with a valid complete block
+*/
+size_t SampleDecoder::decode(const uint8_t *data, size_t size, std::vector<int16_t> &samples) {
+    if (size < kCodecHeaderSize || (data[0] | data[1] << 8) != kCodecSync || data[3] != kCodecVersion) return 0;
+    int channels = data[2];
+    int count = data[4] | data[5] << 8;
+    uint32_t payload = 0;
+    for (int i = 0; i < 4; i++) payload |= static_cast<uint32_t>(data[6 + i]) << (8 * i);
+    if (channels == 0 || count == 0 || payload > size - kCodecHeaderSize) return 0;
+
+    const uint8_t *in = data + kCodecHeaderSize;
+    const uint8_t *end = in + payload;
+    samples.resize(static_cast<size_t>(channels) * count);
+    for (int c = 0; c < channels; c++) {
+        if (end - in < 3 || in[0] > CODEC_SECOND) return 0;
+        int predictor = in[0];
+        int32_t previous = static_cast<int16_t>(in[1] | in[2] << 8);
+        int32_t delta = 0;
+        in += 3;
+        samples[c] = static_cast<int16_t>(previous);
+
+        for (int start = 1; start < count; start += kCodecGroup) {
+            int stop = start + kCodecGroup < count ? start + kCodecGroup : count;
+            if (in >= end || in[0] > 32) return 0;
+            int width = *in++;
+            size_t bytes = (static_cast<size_t>(stop - start) * width + 7) / 8;
+            if (static_cast<size_t>(end - in) < bytes) return 0;
+
+            uint64_t buffer = 0;
+            int available = 0;
+            uint32_t mask = width == 32 ? 0xFFFFFFFFu : (1u << width) - 1;
+            for (int i = start; i < stop; i++) {
+                while (available < width) {
+                    buffer |= static_cast<uint64_t>(*in++) << available;
+                    available += 8;
+                }
+                int32_t residual = zigzagDecode(static_cast<uint32_t>(buffer) & mask);
+                buffer >>= width;
+                available -= width;
+
+                int32_t value;
+                if (predictor == CODEC_RAW) {
+                    value = residual;
+                } else if (predictor == CODEC_DELTA || i < 2) {
+                    value = previous + residual;
+                } else {
+                    value = previous + delta + residual;
+                }
+                delta = value - previous;
+                previous = value;
+                samples[static_cast<size_t>(i) * channels + c] = static_cast<int16_t>(value);
+            }
+        }
+    }
+    num_channels_ = channels;
+    num_samples_ = count;
+    return kCodecHeaderSize + payload;
+}
+
+/* returns the channels of the last block decoded */
+int SampleDecoder::getNumChannels() {
+    return num_channels_;
+}
+
+/* returns the samples of the last block decoded */
+int SampleDecoder::getNumSamples() {
+    return num_samples_;
+}
+
+} // namespace pimu
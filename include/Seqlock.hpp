@@ -0,0 +1,75 @@
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace pimu {
+
+/*
+    single writer / multiple reader snapshot of a trivially copyable struct
+    the writer never waits, readers copy the value and retry if a write happened meanwhile
+    the value is kept in atomic words so concurrent copies are not a data race
+*/
+template<typename T>
+class Seqlock {
+    static_assert(std::is_trivially_copyable<T>::value, "Seqlock requires a trivially copyable type.");
+
+private:
+    static const size_t kWords = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    std::atomic<uint64_t> sequence_{0}; // odd while a write is in progress
+    std::atomic<uint64_t> words_[kWords];
+
+public:
+    Seqlock();
+
+    void store(const T &value);
+    T load() const;
+    uint64_t getSequence() const;
+};
+
+/* Constructor: the initial value is all zeros */
+template<typename T>
+Seqlock<T>::Seqlock() {
+    for (size_t i = 0; i < kWords; i++) words_[i].store(0, std::memory_order_relaxed);
+}
+
+/* publishes a new value, only one thread may write */
+template<typename T>
+void Seqlock<T>::store(const T &value) {
+    uint64_t buffer[kWords] = {};
+    std::memcpy(buffer, &value, sizeof(T));
+
+    uint64_t sequence = sequence_.load(std::memory_order_relaxed);
+    sequence_.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    for (size_t i = 0; i < kWords; i++) words_[i].store(buffer[i], std::memory_order_relaxed);
+
+    sequence_.store(sequence + 2, std::memory_order_release);
+}
+
+/* returns the last published value, never torn between two writes */
+template<typename T>
+T Seqlock<T>::load() const {
+    uint64_t buffer[kWords];
+    uint64_t before, after;
+    do {
+        before = sequence_.load(std::memory_order_acquire);
+        for (size_t i = 0; i < kWords; i++) buffer[i] = words_[i].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = sequence_.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+
+    T value;
+    std::memcpy(&value, buffer, sizeof(T));
+    return value;
+}
+
+/* returns the number of values published so far */
+template<typename T>
+uint64_t Seqlock<T>::getSequence() const {
+    return sequence_.load(std::memory_order_acquire) / 2;
+}
+
+} // namespace pimu
@@ -0,0 +1,268 @@
+#ifdef VSCODE_INTELLISENSE_SUPPORT
+#include "Realtime.hpp"
+#include "Seqlock.hpp"
+#endif
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+namespace pimu {
+
+/*
+    layout of a shared memory sample ring: header, then capacity seqlock slots
+    one process publishes, any number of processes map it read-only and keep their own cursor
+*/
+struct SharedRingHeader
+{
+    std::atomic<uint64_t> magic;    // stored last with release, see SharedRingPublisher
+    uint32_t version;
+    uint32_t record_size;       // sizeof(T), readers refuse a ring of a different type
+    uint64_t capacity;          // power of two
+    double sample_rate_hz;      // informative, set by the publisher
+    alignas(64) std::atomic<uint64_t> head;  // records published so far
+};
+
+const uint64_t kSharedRingMagic = 0x50494d5552494e47ULL; // "PIMURING"
+const uint32_t kSharedRingVersion = 1;
+
+template<typename T>
+struct SharedRingEntry
+{
+    uint64_t index;
+    T value;
+};
+
+/* owns a POSIX shared memory ring (/dev/shm/<name>) and writes records to it, never blocks */
+template<typename T>
+class SharedRingPublisher {
+public:
+    SharedRingPublisher(const std::string &name, size_t capacity, double sample_rate_hz = 0.0);
+    ~SharedRingPublisher();
+
+    void publish(const T &item);
+    uint64_t getPublished();
+    void prefault() const;
+
+private:
+    std::string name_;
+    void *map_ = MAP_FAILED;
+    size_t size_ = 0;
+    SharedRingHeader *header_ = nullptr;
+    Seqlock<SharedRingEntry<T>> *slots_ = nullptr;
+    uint64_t mask_ = 0;
+};
+
+/* maps a ring created by SharedRingPublisher read-only, records are read with no system call */
+template<typename T>
+class SharedRingReader {
+public:
+    explicit SharedRingReader(const std::string &name);
+    ~SharedRingReader();
+
+    bool tryRead(T &item);
+    size_t readBatch(T *items, size_t max_items);
+    bool readLatest(T &item);
+    size_t available();
+    uint64_t getOverflowCount();
+    double getSampleRate();
+
+private:
+    void *map_ = MAP_FAILED;
+    size_t size_ = 0;
+    const SharedRingHeader *header_ = nullptr;
+    const Seqlock<SharedRingEntry<T>> *slots_ = nullptr;
+    uint64_t mask_ = 0;
+    uint64_t cursor_ = 0;
+    uint64_t overflows_ = 0;
+};
+
+/* slots start on the first cache line after the header */
+inline size_t sharedRingSlotsOffset() {
+    return (sizeof(SharedRingHeader) + 63) / 64 * 64;
+}
+
+/* Constructor: creates (or replaces) the shared memory object, capacity is rounded up to a power of two */
+template<typename T>
+SharedRingPublisher<T>::SharedRingPublisher(const std::string &name, size_t capacity, double sample_rate_hz) : name_(name) {
+    if (capacity < 2) {
+        throw std::invalid_argument("The ring capacity must be at least 2.");
+    }
+    size_t rounded = 2;
+    while (rounded < capacity) rounded *= 2;
+    mask_ = rounded - 1;
+    size_ = sharedRingSlotsOffset() + rounded * sizeof(Seqlock<SharedRingEntry<T>>);
+
+    shm_unlink(name_.c_str());
+    int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to create the shared memory ring " + name_ + ".");
+    }
+    if (ftruncate(fd, static_cast<off_t>(size_)) < 0) {
+        close(fd);
+        shm_unlink(name_.c_str());
+        throw std::runtime_error("Failed to size the shared memory ring " + name_ + ".");
+    }
+    map_ = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map_ == MAP_FAILED) {
+        shm_unlink(name_.c_str());
+        throw std::runtime_error("Failed to map the shared memory ring " + name_ + ".");
+    }
+
+    // slots first, the header (and its magic) last, so a reader never sees a half built ring
+    char *base = static_cast<char *>(map_);
+    slots_ = reinterpret_cast<Seqlock<SharedRingEntry<T>> *>(base + sharedRingSlotsOffset());
+    for (size_t i = 0; i < rounded; i++) new (&slots_[i]) Seqlock<SharedRingEntry<T>>();
+
+    header_ = new (base) SharedRingHeader();
+    header_->version = kSharedRingVersion;
+    header_->record_size = sizeof(T);
+    header_->capacity = rounded;
+    header_->sample_rate_hz = sample_rate_hz;
+    header_->head.store(0, std::memory_order_relaxed);
+    header_->magic.store(kSharedRingMagic, std::memory_order_release);
+}
+
+/* Destructor, removes the shared memory object, readers that have it mapped keep their copy */
+template<typename T>
+SharedRingPublisher<T>::~SharedRingPublisher() {
+    if (map_ != MAP_FAILED) munmap(map_, size_);
+    shm_unlink(name_.c_str());
+}
+
+/* writes a record over the oldest one, producer thread only */
+template<typename T>
+void SharedRingPublisher<T>::publish(const T &item) {
+    uint64_t head = header_->head.load(std::memory_order_relaxed);
+    SharedRingEntry<T> entry;
+    entry.index = head;
+    entry.value = item;
+    slots_[head & mask_].store(entry);
+    header_->head.store(head + 1, std::memory_order_release);
+}
+
+/* returns the number of records published so far */
+template<typename T>
+uint64_t SharedRingPublisher<T>::getPublished() {
+    return header_->head.load(std::memory_order_relaxed);
+}
+
+/* touches every page of the mapping, see prefaultMemory() */
+template<typename T>
+void SharedRingPublisher<T>::prefault() const {
+    prefaultMemory(map_, size_);
+}
+
+/* Constructor: maps the ring read-only and starts at the next record to be published */
+template<typename T>
+SharedRingReader<T>::SharedRingReader(const std::string &name) {
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open the shared memory ring " + name + ".");
+    }
+    struct stat info;
+    if (fstat(fd, &info) < 0 || static_cast<size_t>(info.st_size) < sharedRingSlotsOffset()) {
+        close(fd);
+        throw std::runtime_error("The shared memory ring " + name + " is not ready.");
+    }
+    size_ = static_cast<size_t>(info.st_size);
+    map_ = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map_ == MAP_FAILED) {
+        throw std::runtime_error("Failed to map the shared memory ring " + name + ".");
+    }
+
+    // the magic first: its acquire load makes the rest of the header written before it visible
+    header_ = static_cast<const SharedRingHeader *>(map_);
+    bool valid = header_->magic.load(std::memory_order_acquire) == kSharedRingMagic &&
+                 header_->version == kSharedRingVersion &&
+                 header_->record_size == sizeof(T) &&
+                 sharedRingSlotsOffset() + header_->capacity * sizeof(Seqlock<SharedRingEntry<T>>) <= size_;
+    if (!valid) {
+        munmap(map_, size_);
+        map_ = MAP_FAILED;
+        throw std::runtime_error("The shared memory ring " + name + " has a different format.");
+    }
+    slots_ = reinterpret_cast<const Seqlock<SharedRingEntry<T>> *>(static_cast<const char *>(map_) + sharedRingSlotsOffset());
+    mask_ = header_->capacity - 1;
+    cursor_ = header_->head.load(std::memory_order_acquire);
+}
+
+/* Destructor */
+template<typename T>
+SharedRingReader<T>::~SharedRingReader() {
+    if (map_ != MAP_FAILED) munmap(map_, size_);
+}
+
+/* takes the next record, returns false if there is none */
+template<typename T>
+bool SharedRingReader<T>::tryRead(T &item) {
+    return readBatch(&item, 1) == 1;
+}
+
+/* takes up to max_items records in order, records overwritten before being read are counted as overflows */
+template<typename T>
+size_t SharedRingReader<T>::readBatch(T *items, size_t max_items) {
+    size_t count = 0;
+    while (count < max_items) {
+        uint64_t head = header_->head.load(std::memory_order_acquire);
+        if (cursor_ == head) break;
+
+        // the publisher lapped this reader, skip to the oldest record still stored
+        uint64_t oldest = head > mask_ ? head - mask_ : 0;
+        if (cursor_ < oldest) {
+            overflows_ += oldest - cursor_;
+            cursor_ = oldest;
+        }
+
+        SharedRingEntry<T> entry = slots_[cursor_ & mask_].load();
+        if (entry.index != cursor_) continue; // overwritten while reading, recheck the head
+
+        items[count++] = entry.value;
+        cursor_++;
+    }
+    return count;
+}
+
+/* returns the newest record and moves the cursor past it (skipped records are not overflows), false if nothing was published yet */
+template<typename T>
+bool SharedRingReader<T>::readLatest(T &item) {
+    while (true) {
+        uint64_t head = header_->head.load(std::memory_order_acquire);
+        if (head == 0) return false;
+        SharedRingEntry<T> entry = slots_[(head - 1) & mask_].load();
+        if (entry.index != head - 1) continue;
+        item = entry.value;
+        cursor_ = head;
+        return true;
+    }
+}
+
+/* returns the number of records waiting */
+template<typename T>
+size_t SharedRingReader<T>::available() {
+    return static_cast<size_t>(header_->head.load(std::memory_order_acquire) - cursor_);
+}
+
+/* returns the number of records this reader skipped */
+template<typename T>
+uint64_t SharedRingReader<T>::getOverflowCount() {
+    return overflows_;
+}
+
+/* returns the sample rate announced by the publisher [Hz] */
+template<typename T>
+double SharedRingReader<T>::getSampleRate() {
+    return header_->sample_rate_hz;
+}
+
+} // namespace pimu
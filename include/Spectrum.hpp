@@ -0,0 +1,397 @@
+#ifdef VSCODE_INTELLISENSE_SUPPORT
+#include "type.hpp"
+#endif
+
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace pimu {
+
+/* maximum number of frequency bands reported per channel */
+const int kSpectrumMaxBands = 16;
+
+/* spectrum summary of the last analyzed block of one channel */
+struct SpectrumResult
+{
+    /* frequency of the highest non DC bin, parabolic interpolated [Hz] */
+    float peak_frequency;
+
+    /* amplitude of the peak [channel unit] */
+    float peak_amplitude;
+
+    /* mean square value inside each band [channel unit^2] */
+    float band_energy[kSpectrumMaxBands];
+
+    /* number of blocks analyzed so far */
+    uint64_t block;
+};
+
+/*
+    streaming spectral analyzer for gyro and accel data
+    samples are pushed from the acquisition loop, every hop_size samples a Hann windowed
+    real FFT of the last fft_size samples is computed on a worker thread
+*/
+class Spectrum {
+public:
+    enum Channel
+    {
+        GYRO_X,
+        GYRO_Y,
+        GYRO_Z,
+        ACCEL_X,
+        ACCEL_Y,
+        ACCEL_Z,
+        NUM_CHANNELS
+    };
+
+    Spectrum(float sample_rate_hz, int fft_size, int hop_size);
+    ~Spectrum();
+
+    int setBands(const std::vector<float> &edges_hz);
+    int start();
+    void stop();
+
+    void push(const MultiSensor &sample);
+
+    SpectrumResult getResult(int channel);
+    float getPeakFrequency(int channel);
+    float getBandEnergy(int channel, int band);
+    uint64_t getDroppedBlocks();
+
+private:
+    float sample_rate_;
+    int fft_size_;
+    int hop_size_;
+
+    // producer side, one ring per channel
+    std::vector<float> ring_;
+    int ring_head_ = 0;
+    int hop_count_ = 0;
+    uint64_t num_samples_ = 0;
+
+    // block handed to the worker
+    std::vector<float> job_;
+    bool job_ready_ = false;
+    std::atomic<uint64_t> dropped_blocks_{0};
+
+    // precomputed tables
+    std::vector<float> window_;
+    float window_sum_ = 0.0f;
+    float window_power_ = 0.0f;
+    std::vector<float> twiddle_re_;
+    std::vector<float> twiddle_im_;
+    std::vector<float> real_twiddle_re_;
+    std::vector<float> real_twiddle_im_;
+    std::vector<int> bit_reverse_;
+
+    // worker buffers
+    std::vector<float> re_;
+    std::vector<float> im_;
+    std::vector<float> power_;
+
+    std::vector<float> band_edges_;
+    SpectrumResult results_[NUM_CHANNELS];
+
+    std::thread worker_;
+    std::mutex mutex_;
+    std::condition_variable job_cv_;
+    bool running_ = false;
+
+    void workerLoop();
+    void analyze(const float *block, SpectrumResult &result);
+    void complexFft();
+};
+
+/* sample_rate_hz: rate of push() calls, fft_size: power of two, hop_size: samples between blocks */
+Spectrum::Spectrum(float sample_rate_hz, int fft_size, int hop_size)
+    : sample_rate_(sample_rate_hz), fft_size_(fft_size), hop_size_(hop_size) {
+    if (fft_size < 8 || (fft_size & (fft_size - 1)) != 0) {
+        throw std::invalid_argument("The FFT size must be a power of two greater or equal than 8.");
+    }
+    if (hop_size < 1 || hop_size > fft_size) {
+        throw std::invalid_argument("The hop size must be in the range [1, fft_size].");
+    }
+    if (sample_rate_hz <= 0.0f) {
+        throw std::invalid_argument("The sample rate must be positive.");
+    }
+
+    const double pi = 3.14159265358979323846;
+    int half = fft_size_ / 2;
+
+    ring_.assign(NUM_CHANNELS * fft_size_, 0.0f);
+    job_.assign(NUM_CHANNELS * fft_size_, 0.0f);
+    re_.assign(half, 0.0f);
+    im_.assign(half, 0.0f);
+    power_.assign(half + 1, 0.0f);
+
+    // Hann window
+    window_.resize(fft_size_);
+    for (int i = 0; i < fft_size_; i++) {
+        window_[i] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * pi * i / fft_size_));
+        window_sum_ += window_[i];
+        window_power_ += window_[i] * window_[i];
+    }
+
+    // twiddles of the N/2 complex FFT, stored per stage so butterflies read them contiguously:
+    // stage with half length h uses entries [h, 2h)
+    twiddle_re_.assign(half, 0.0f);
+    twiddle_im_.assign(half, 0.0f);
+    for (int h = 1; h < half; h *= 2) {
+        for (int j = 0; j < h; j++) {
+            twiddle_re_[h + j] = static_cast<float>(std::cos(-pi * j / h));
+            twiddle_im_[h + j] = static_cast<float>(std::sin(-pi * j / h));
+        }
+    }
+
+    // twiddles used to split the packed complex result into the real spectrum
+    real_twiddle_re_.resize(half);
+    real_twiddle_im_.resize(half);
+    for (int k = 0; k < half; k++) {
+        real_twiddle_re_[k] = static_cast<float>(std::cos(-2.0 * pi * k / fft_size_));
+        real_twiddle_im_[k] = static_cast<float>(std::sin(-2.0 * pi * k / fft_size_));
+    }
+
+    bit_reverse_.resize(half);
+    int bits = 0;
+    while ((1 << bits) < half) bits++;
+    for (int i = 0; i < half; i++) {
+        int r = 0;
+        for (int b = 0; b < bits; b++) {
+            if (i & (1 << b)) r |= 1 << (bits - 1 - b);
+        }
+        bit_reverse_[i] = r;
+    }
+
+    // single band covering the whole spectrum by default
+    band_edges_ = {0.0f, sample_rate_ / 2.0f};
+    for (int c = 0; c < NUM_CHANNELS; c++) results_[c] = SpectrumResult();
+}
+
+/* stops the worker thread if it is running */
+Spectrum::~Spectrum() {
+    stop();
+}
+
+/*
+    sets the band limits [Hz], n edges define n-1 consecutive bands
+    obs: the worker reads them without the lock, returns -1 while it runs (between Spectrum::start() and stop())
+*/
+int Spectrum::setBands(const std::vector<float> &edges_hz) {
+    if (edges_hz.size() < 2 || edges_hz.size() > static_cast<size_t>(kSpectrumMaxBands + 1)) {
+        throw std::invalid_argument("The number of band edges must be in the range [2, kSpectrumMaxBands + 1].");
+    }
+    for (size_t i = 1; i < edges_hz.size(); i++) {
+        if (edges_hz[i] <= edges_hz[i - 1]) {
+            throw std::invalid_argument("The band edges must be in ascending order.");
+        }
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) {
+        std::cout << "No se pueden cambiar las bandas con el analizador en ejecucion.\n";
+        return -1;
+    }
+    band_edges_ = edges_hz;
+    return 1;
+}
+
+/* starts the worker thread, returns -1 if it was already running */
+int Spectrum::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) return -1;
+    running_ = true;
+    worker_ = std::thread(&Spectrum::workerLoop, this);
+    return 1;
+}
+
+/* stops and joins the worker thread */
+void Spectrum::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) return;
+        running_ = false;
+    }
+    job_cv_.notify_one();
+    if (worker_.joinable()) worker_.join();
+}
+
+/* adds one sample (gyro [rad/s], accel [G]), should be called at sample_rate_hz from a single thread */
+void Spectrum::push(const MultiSensor &sample) {
+    const float values[NUM_CHANNELS] = {sample.gx, sample.gy, sample.gz, sample.ax, sample.ay, sample.az};
+    for (int c = 0; c < NUM_CHANNELS; c++) {
+        ring_[c * fft_size_ + ring_head_] = values[c];
+    }
+    ring_head_ = (ring_head_ + 1) % fft_size_;
+    num_samples_++;
+
+    if (++hop_count_ < hop_size_ || num_samples_ < static_cast<uint64_t>(fft_size_)) return;
+    hop_count_ = 0;
+
+    // hand the block to the worker, if it is still busy with the previous one the block is dropped
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (job_ready_) {
+            dropped_blocks_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        int older = fft_size_ - ring_head_;
+        for (int c = 0; c < NUM_CHANNELS; c++) {
+            const float *src = &ring_[c * fft_size_];
+            float *dst = &job_[c * fft_size_];
+            std::copy(src + ring_head_, src + fft_size_, dst);
+            std::copy(src, src + ring_head_, dst + older);
+        }
+        job_ready_ = true;
+    }
+    job_cv_.notify_one();
+}
+
+/* returns a copy of the last result of a channel (Spectrum::Channel) */
+SpectrumResult Spectrum::getResult(int channel) {
+    if (channel < 0 || channel >= NUM_CHANNELS) {
+        throw std::out_of_range("Invalid spectrum channel.");
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    return results_[channel];
+}
+
+/* returns the dominant frequency of a channel [Hz] */
+float Spectrum::getPeakFrequency(int channel) {
+    return getResult(channel).peak_frequency;
+}
+
+/* returns the mean square value of a channel inside a band [channel unit^2] */
+float Spectrum::getBandEnergy(int channel, int band) {
+    if (band < 0 || band >= kSpectrumMaxBands) {
+        throw std::out_of_range("Invalid spectrum band.");
+    }
+    return getResult(channel).band_energy[band];
+}
+
+/* returns the number of blocks skipped because the worker was busy */
+uint64_t Spectrum::getDroppedBlocks() {
+    return dropped_blocks_.load(std::memory_order_relaxed);
+}
+
+/* waits for blocks and analyzes every channel */
+void Spectrum::workerLoop() {
+    SpectrumResult local[NUM_CHANNELS];
+    std::vector<float> block(job_.size());
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            job_cv_.wait(lock, [this] { return job_ready_ || !running_; });
+            if (!running_) return;
+            block.swap(job_);
+            job_ready_ = false;
+            for (int c = 0; c < NUM_CHANNELS; c++) local[c] = results_[c];
+        }
+
+        for (int c = 0; c < NUM_CHANNELS; c++) {
+            analyze(&block[c * fft_size_], local[c]);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (int c = 0; c < NUM_CHANNELS; c++) results_[c] = local[c];
+    }
+}
+
+/* windowed real FFT of one channel block, updates peak and band energies */
+void Spectrum::analyze(const float *block, SpectrumResult &result) {
+    int half = fft_size_ / 2;
+
+    // remove the mean so gravity and biases don't leak into the low bins
+    float mean = 0.0f;
+    for (int i = 0; i < fft_size_; i++) mean += block[i];
+    mean /= fft_size_;
+
+    // pack even samples as real part and odd samples as imaginary part, in bit reversed order
+    for (int i = 0; i < half; i++) {
+        int r = bit_reverse_[i];
+        re_[r] = (block[2 * i] - mean) * window_[2 * i];
+        im_[r] = (block[2 * i + 1] - mean) * window_[2 * i + 1];
+    }
+
+    complexFft();
+
+    // split the N/2 complex spectrum into the N real spectrum bins 0..N/2
+    power_[0] = (re_[0] + im_[0]) * (re_[0] + im_[0]);
+    power_[half] = (re_[0] - im_[0]) * (re_[0] - im_[0]);
+    for (int k = 1; k < half; k++) {
+        float zr = re_[k], zi = im_[k];
+        float cr = re_[half - k], ci = -im_[half - k];
+        float er = 0.5f * (zr + cr), ei = 0.5f * (zi + ci);
+        float dr = 0.5f * (zr - cr), di = 0.5f * (zi - ci);
+        // odd part is -i * d * W^k
+        float wr = real_twiddle_re_[k], wi = real_twiddle_im_[k];
+        float odd_r = di * wr + dr * wi;
+        float odd_i = di * wi - dr * wr;
+        float xr = er + odd_r, xi = ei + odd_i;
+        power_[k] = xr * xr + xi * xi;
+    }
+
+    // one sided power normalized so the sum over bins equals the mean square of the signal
+    float scale = 2.0f / (fft_size_ * window_power_);
+    float bin_hz = sample_rate_ / fft_size_;
+
+    int peak = 1;
+    for (int k = 1; k <= half; k++) {
+        if (power_[k] > power_[peak]) peak = k;
+    }
+
+    float offset = 0.0f;
+    if (peak > 1 && peak < half) {
+        float a = std::sqrt(power_[peak - 1]), b = std::sqrt(power_[peak]), c = std::sqrt(power_[peak + 1]);
+        float denominator = a - 2.0f * b + c;
+        if (denominator != 0.0f) offset = 0.5f * (a - c) / denominator;
+    }
+    result.peak_frequency = (peak + offset) * bin_hz;
+    result.peak_amplitude = 2.0f * std::sqrt(power_[peak]) / window_sum_;
+
+    size_t num_bands = band_edges_.size() - 1;
+    for (size_t b = 0; b < static_cast<size_t>(kSpectrumMaxBands); b++) {
+        result.band_energy[b] = 0.0f;
+        if (b >= num_bands) continue;
+        for (int k = 1; k <= half; k++) {
+            float f = k * bin_hz;
+            if (f >= band_edges_[b] && f < band_edges_[b + 1]) result.band_energy[b] += power_[k] * scale;
+        }
+    }
+    result.block++;
+}
+
+/* in place iterative radix-2 FFT over re_ and im_ (input already in bit reversed order) */
+void Spectrum::complexFft() {
+    int n = fft_size_ / 2;
+    float *__restrict re = re_.data();
+    float *__restrict im = im_.data();
+    const float *__restrict tw_re = twiddle_re_.data();
+    const float *__restrict tw_im = twiddle_im_.data();
+
+    for (int h = 1; h < n; h *= 2) {
+        for (int s = 0; s < n; s += 2 * h) {
+            float *__restrict a_re = re + s;
+            float *__restrict a_im = im + s;
+            float *__restrict b_re = re + s + h;
+            float *__restrict b_im = im + s + h;
+            // split real/imaginary arrays and contiguous twiddles let the compiler vectorize this loop
+            for (int j = 0; j < h; j++) {
+                float t_re = b_re[j] * tw_re[h + j] - b_im[j] * tw_im[h + j];
+                float t_im = b_re[j] * tw_im[h + j] + b_im[j] * tw_re[h + j];
+                b_re[j] = a_re[j] - t_re;
+                b_im[j] = a_im[j] - t_im;
+                a_re[j] += t_re;
+                a_im[j] += t_im;
+            }
+        }
+    }
+}
+
+} // namespace pimu
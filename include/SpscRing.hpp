@@ -0,0 +1,122 @@
+#ifdef VSCODE_INTELLISENSE_SUPPORT
+#include "Realtime.hpp"
+#endif
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+// new only honours alignas(64) from C++17 on, before that the rings are allocated misaligned (-Waligned-new)
+#if __cplusplus < 201703L
+#error "pimu needs C++17 (-std=c++17 or gnu++17), GCC 10 and older default to C++14."
+#endif
+
+namespace pimu {
+
+/*
+    lock-free single producer / single consumer ring of fixed size records
+    push() never blocks, when the ring is full the record is dropped and counted as an overflow
+*/
+template<typename T>
+class SpscRing {
+private:
+    std::vector<T> buffer_;
+    size_t mask_;
+
+    // producer and consumer indexes live on separate cache lines
+    alignas(64) std::atomic<uint64_t> head_{0};   // next position to write, owned by the producer
+    uint64_t cached_tail_ = 0;                    // producer copy of tail_
+    alignas(64) std::atomic<uint64_t> tail_{0};   // next position to read, owned by the consumer
+    uint64_t cached_head_ = 0;                    // consumer copy of head_
+    alignas(64) std::atomic<uint64_t> overflows_{0};
+
+public:
+    explicit SpscRing(size_t capacity);
+
+    bool push(const T &item);
+    bool pop(T &item);
+    size_t popBatch(T *items, size_t max_items);
+    size_t size();
+    size_t capacity();
+    uint64_t getOverflowCount();
+    void prefault() const;
+};
+
+/* Constructor: capacity is rounded up to a power of two */
+template<typename T>
+SpscRing<T>::SpscRing(size_t capacity) {
+    if (capacity < 2) {
+        throw std::invalid_argument("The ring capacity must be at least 2.");
+    }
+    size_t rounded = 2;
+    while (rounded < capacity) rounded *= 2;
+    buffer_.resize(rounded);
+    mask_ = rounded - 1;
+}
+
+/* adds a record, returns false (and counts an overflow) if the ring is full, producer thread only */
+template<typename T>
+bool SpscRing<T>::push(const T &item) {
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    if (head - cached_tail_ > mask_) {
+        cached_tail_ = tail_.load(std::memory_order_acquire);
+        if (head - cached_tail_ > mask_) {
+            overflows_.store(overflows_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return false;
+        }
+    }
+    buffer_[head & mask_] = item;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+/* takes the oldest record, returns false if the ring is empty, consumer thread only */
+template<typename T>
+bool SpscRing<T>::pop(T &item) {
+    return popBatch(&item, 1) == 1;
+}
+
+/* takes up to max_items records in order, returns how many were copied, consumer thread only */
+template<typename T>
+size_t SpscRing<T>::popBatch(T *items, size_t max_items) {
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    if (cached_head_ - tail < max_items) {
+        cached_head_ = head_.load(std::memory_order_acquire);
+    }
+    size_t count = static_cast<size_t>(cached_head_ - tail);
+    if (count > max_items) count = max_items;
+
+    for (size_t i = 0; i < count; i++) {
+        items[i] = buffer_[(tail + i) & mask_];
+    }
+    tail_.store(tail + count, std::memory_order_release);
+    return count;
+}
+
+/* returns the number of records waiting, approximate while the other side is running */
+template<typename T>
+size_t SpscRing<T>::size() {
+    return static_cast<size_t>(head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire));
+}
+
+/* returns the maximum number of records */
+template<typename T>
+size_t SpscRing<T>::capacity() {
+    return mask_ + 1;
+}
+
+/* returns the number of records dropped because the ring was full */
+template<typename T>
+uint64_t SpscRing<T>::getOverflowCount() {
+    return overflows_.load(std::memory_order_relaxed);
+}
+
+/* touches every page of the records, see prefaultMemory() */
+template<typename T>
+void SpscRing<T>::prefault() const {
+    prefaultMemory(buffer_.data(), buffer_.size() * sizeof(T));
+}
+
+} // namespace pimu
@@ -0,0 +1,250 @@
+#ifdef VSCODE_INTELLISENSE_SUPPORT
+#include "Imu.hpp"
+#include "ImuArray.hpp"
+#include "type.hpp"
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+
+namespace pimu {
+
+const int kMaxVirtualImus = 8;
+
+/* per device correction of one three axis sensor: corrected = rotation * ((raw - bias) * scale) */
+struct SensorCorrection
+{
+    /* offset removed from every axis, same units as the readings */
+    Sensor bias = {0.0f, 0.0f, 0.0f};
+
+    /* gain applied per axis after the bias */
+    Sensor scale = {1.0f, 1.0f, 1.0f};
+
+    /* misalignment, rotates the device axes onto the common body axes (row major) */
+    float rotation[3][3] = {{1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}};
+};
+
+/* gyro and accel corrections of one device of a VirtualImu */
+struct ImuCorrection
+{
+    SensorCorrection gyro;
+    SensorCorrection accel;
+};
+
+/*
+    combines N rigidly mounted Imus into one virtual sensor with lower noise (about 1/sqrt(N) for equal devices)
+    every reading is corrected for the bias, scale and misalignment of its device, then each axis is the weighted mean
+    of the devices that agree with the median of all of them (outliers are voted out using the MAD)
+    obs: no allocation, the cost is linear in the number of devices
+*/
+class VirtualImu {
+public:
+    VirtualImu();
+
+    int add(Imu &imu, float weight = 1.0f);
+    int setCorrection(int index, const ImuCorrection &correction);
+    int setWeight(int index, float weight);
+    void setOutlierRejection(float num_deviations, float min_deviation = 0.0f);
+    int getImuCount();
+    uint64_t getRejectedReadings(int index);
+
+    MultiSensor read();
+    MultiSensor fuse(const ImuFrame &frame);
+    void print(MultiSensor read_data);
+
+private:
+    Imu *imus_[kMaxVirtualImus];
+    ImuCorrection corrections_[kMaxVirtualImus];
+    float weights_[kMaxVirtualImus];
+    uint64_t rejected_[kMaxVirtualImus];
+    int num_imus_ = 0;
+
+    float num_deviations_ = 3.0f;   // 0 disables the voting
+    float min_deviation_ = 0.0f;
+
+    MultiSensor combine(const MultiSensor *readings, int count);
+    static MultiSensor toReading(const ImuSample &sample);
+    static Sensor correct(const SensorCorrection &correction, float x, float y, float z);
+    static float median(float *values, int count);
+};
+
+/* Constructor: starts empty, outliers further than 3 deviations are rejected */
+VirtualImu::VirtualImu() {}
+
+/* adds a device with a relative weight (e.g. 1 / noise variance), returns its index or -1 if full */
+int VirtualImu::add(Imu &imu, float weight) {
+    if (weight <= 0.0f) {
+        throw std::invalid_argument("The weight must be positive.");
+    }
+    if (num_imus_ >= kMaxVirtualImus) {
+        std::cout << "No se pueden agregar mas de " << kMaxVirtualImus << " Imus al sensor virtual.\n";
+        return -1;
+    }
+    imus_[num_imus_] = &imu;
+    corrections_[num_imus_] = ImuCorrection();
+    weights_[num_imus_] = weight;
+    rejected_[num_imus_] = 0;
+    return num_imus_++;
+}
+
+/* sets bias, scale and misalignment of a device, returns -1 if the index does not exist */
+int VirtualImu::setCorrection(int index, const ImuCorrection &correction) {
+    if (index < 0 || index >= num_imus_) return -1;
+    corrections_[index] = correction;
+    return 1;
+}
+
+/* sets the relative weight of a device, returns -1 if the index does not exist */
+int VirtualImu::setWeight(int index, float weight) {
+    if (weight <= 0.0f) {
+        throw std::invalid_argument("The weight must be positive.");
+    }
+    if (index < 0 || index >= num_imus_) return -1;
+    weights_[index] = weight;
+    return 1;
+}
+
+/*
+    readings further than num_deviations * 1.4826 * MAD from the median of all devices are left out of the mean,
+    deviations smaller than min_deviation are never rejected
+    obs: needs at least 3 devices, num_deviations = 0 disables the voting, otherwise it must be at least 1
+*/
+void VirtualImu::setOutlierRejection(float num_deviations, float min_deviation) {
+    if (num_deviations < 0.0f || min_deviation < 0.0f) {
+        throw std::invalid_argument("The threshold and the minimum deviation must be non negative.");
+    }
+    if (num_deviations > 0.0f && num_deviations < 1.0f) {
+        // below 1 / 1.4826 an even number of devices can all be further than the threshold from their median
+        throw std::invalid_argument("The threshold must be 0 (disabled) or at least 1 deviation.");
+    }
+    num_deviations_ = num_deviations;
+    min_deviation_ = min_deviation;
+}
+
+/* returns the number of devices */
+int VirtualImu::getImuCount() {
+    return num_imus_;
+}
+
+/* returns how many readings of a device had at least one axis voted out */
+uint64_t VirtualImu::getRejectedReadings(int index) {
+    if (index < 0 || index >= num_imus_) return 0;
+    return rejected_[index];
+}
+
+/*
+    reads every device (Imu::readSample()) and returns the fused gyro [rad/s] and specific force, gravity included [G]
+    obs: same quantities as VirtualImu::fuse(), unrounded so the mean can go below the 0.01 steps of Imu::read()
+*/
+MultiSensor VirtualImu::read() {
+    MultiSensor readings[kMaxVirtualImus];
+    for (int i = 0; i < num_imus_; i++) readings[i] = toReading(imus_[i]->readSample());
+    return combine(readings, num_imus_);
+}
+
+/* fuses a frame of time aligned samples from an ImuArray holding the same devices in the same order, see VirtualImu::read() */
+MultiSensor VirtualImu::fuse(const ImuFrame &frame) {
+    if (frame.num_imus != num_imus_) {
+        throw std::invalid_argument("The frame and the virtual sensor have a different number of devices.");
+    }
+    MultiSensor readings[kMaxVirtualImus];
+    for (int i = 0; i < num_imus_; i++) readings[i] = toReading(frame.samples[i]);
+    return combine(readings, num_imus_);
+}
+
+/* prints the fused readings in the same format as Imu::print() */
+void VirtualImu::print(MultiSensor read_data) {
+    std::cout << "Gyro (x, y, z): " << read_data.gx << "rad/s, "
+              << read_data.gy << "rad/s, "
+              << read_data.gz << "rad/s\n";
+    std::cout << "Accel (x, y, z): " << read_data.ax << "G, "
+              << read_data.ay << "G, "
+              << read_data.az << "G\n";
+}
+
+/* corrects the readings and fuses them axis by axis */
+MultiSensor VirtualImu::combine(const MultiSensor *readings, int count) {
+    const int kChannels = 6;
+    float values[kChannels][kMaxVirtualImus];
+    for (int i = 0; i < count; i++) {
+        Sensor gyro = correct(corrections_[i].gyro, readings[i].gx, readings[i].gy, readings[i].gz);
+        Sensor accel = correct(corrections_[i].accel, readings[i].ax, readings[i].ay, readings[i].az);
+        values[0][i] = gyro.x;
+        values[1][i] = gyro.y;
+        values[2][i] = gyro.z;
+        values[3][i] = accel.x;
+        values[4][i] = accel.y;
+        values[5][i] = accel.z;
+    }
+
+    bool voting = num_deviations_ > 0.0f && count >= 3;
+    bool outlier[kMaxVirtualImus] = {};
+    float fused[kChannels] = {};
+    for (int c = 0; c < kChannels; c++) {
+        float center = 0.0f;
+        float threshold = 0.0f;
+        if (voting) {
+            float scratch[kMaxVirtualImus];
+            std::copy(values[c], values[c] + count, scratch);
+            center = median(scratch, count);
+            for (int i = 0; i < count; i++) scratch[i] = std::fabs(values[c][i] - center);
+            threshold = std::max(num_deviations_ * 1.4826f * median(scratch, count), min_deviation_);
+        }
+
+        float sum = 0.0f;
+        float weight_sum = 0.0f;
+        bool left_out[kMaxVirtualImus] = {};
+        for (int i = 0; i < count; i++) {
+            if (voting && std::fabs(values[c][i] - center) > threshold) {
+                left_out[i] = true;
+                continue;
+            }
+            sum += weights_[i] * values[c][i];
+            weight_sum += weights_[i];
+        }
+        if (weight_sum > 0.0f) {
+            fused[c] = sum / weight_sum;
+            for (int i = 0; i < count; i++) outlier[i] = outlier[i] || left_out[i];
+        } else {
+            // with an even count the median is between two devices and all of them can be voted out,
+            // the vote is inconclusive then and the median is used
+            fused[c] = center;
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        if (outlier[i]) rejected_[i]++;
+    }
+
+    return {fused[0], fused[1], fused[2], fused[3], fused[4], fused[5]};
+}
+
+/* gyro and specific force of a sample, the quantities both VirtualImu::read() and VirtualImu::fuse() combine */
+MultiSensor VirtualImu::toReading(const ImuSample &sample) {
+    return {sample.gyro.x, sample.gyro.y, sample.gyro.z, sample.accel.x, sample.accel.y, sample.accel.z};
+}
+
+/* applies bias, scale and misalignment to one reading */
+Sensor VirtualImu::correct(const SensorCorrection &correction, float x, float y, float z) {
+    float u = (x - correction.bias.x) * correction.scale.x;
+    float v = (y - correction.bias.y) * correction.scale.y;
+    float w = (z - correction.bias.z) * correction.scale.z;
+    const float (*r)[3] = correction.rotation;
+    return {r[0][0] * u + r[0][1] * v + r[0][2] * w,
+            r[1][0] * u + r[1][1] * v + r[1][2] * w,
+            r[2][0] * u + r[2][1] * v + r[2][2] * w};
+}
+
+/* median of count values (reorders them), linear time on average */
+float VirtualImu::median(float *values, int count) {
+    int middle = count / 2;
+    std::nth_element(values, values + middle, values + count);
+    float upper = values[middle];
+    if (count % 2 == 1) return upper;
+    float lower = *std::max_element(values, values + middle);
+    return 0.5f * (lower + upper);
+}
+
+} // namespace pimu
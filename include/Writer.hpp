@@ -1,6 +1,13 @@
+#ifdef VSCODE_INTELLISENSE_SUPPORT
+#include "AsyncWriter.hpp"
+#endif
+
+#include <charconv>
 #include <fstream>
+#include <memory>
 #include <string>
 #include <iostream>
+#include <type_traits>
 #include <vector>
 #include <sstream>
 
@@ -11,19 +18,35 @@ private:
     std::ofstream file_;     
     bool is_open_;           
     std::string delimiter_;  
+    std::string file_name_;
+    std::unique_ptr<AsyncWriter> async_;   // set by enableAsync(), replaces file_
+    std::string buffer_;     // rows not written yet, reused
+    int precision_ = 6;
+
+    static const size_t kFlushSize = 65536;
+
+    template<typename T> void append_field(const T& value);
+    void end_row();
 
 public:
     Writer(std::string file_name, std::string header, std::string delim);
     ~Writer();
 
     void write_row(const std::vector<std::string>& data);
+    template<typename... Args> void write_row(const Args&... values);
     void write_line(const std::string& line);
+    int setPrecision(int precision);
+    void flush();
+    int enableAsync(size_t block_size, size_t num_blocks, AsyncWriter::Policy policy);
+    uint64_t getBytesWritten();
+    uint64_t getRowsDropped();
     void close();
 };
 
 /* Constructor: abre el archivo y escribe el encabezado si es posible */
 Writer::Writer(std::string file_name, std::string header, std::string delim) 
-    : is_open_(false), delimiter_(delim) {
+    : is_open_(false), delimiter_(delim), file_name_(file_name) {
+    buffer_.reserve(kFlushSize + 1024);
     file_.open(file_name);
     if (file_.is_open()) {
         is_open_ = true;
@@ -35,7 +58,7 @@ Writer::Writer(std::string file_name, std::string header, std::string delim)
 
 /* Destructor: cierra el archivo si está abierto */
 Writer::~Writer() {
-    if (is_open_) file_.close();
+    close();
 }
 
 /* Escribe una fila en el archivo separando los valores con el delimitador */
@@ -44,14 +67,29 @@ void Writer::write_row(const std::vector<std::string>& data) {
         std::cerr << "Error: El archivo no está abierto.\n";
         return;
     } 
-    std::ostringstream oss;
     for (size_t i = 0; i < data.size(); ++i) {
-        oss << data[i];
+        buffer_ += data[i];
         if (i != data.size() - 1) {
-            oss << delimiter_;
+            buffer_ += delimiter_;
         }
     }
-    file_ << oss.str() << "\n";
+    end_row();
+}
+
+/*
+    writes a row of values separated by the delimiter, e.g. write_row(t, gx, gy, gz, ax, ay, az)
+    numbers are formatted with std::to_chars into a reused buffer, no allocation and no locale
+    obs: floats come out as std::ostream writes them (%g with the precision of setPrecision()), bools as 1/0
+*/
+template<typename... Args>
+void Writer::write_row(const Args&... values) {
+    if (!is_open_) {
+        std::cerr << "Error: El archivo no está abierto.\n";
+        return;
+    }
+    bool first = true;
+    ((first ? (void)(first = false) : (void)(buffer_ += delimiter_), append_field(values)), ...);
+    end_row();
 }
 
 /* Escribe una línea en el archivo */
@@ -60,13 +98,93 @@ void Writer::write_line(const std::string& line) {
         std::cerr << "Error: El archivo no está abierto.\n";
         return;
     }
-    file_ << line << "\n";
+    buffer_ += line;
+    end_row();
+}
+
+/* sets the significant digits of the floats written by the typed write_row (1 to 17, 6 by default) */
+int Writer::setPrecision(int precision) {
+    if (precision < 1 || precision > 17) {
+        std::cerr << "Error: Precision fuera de rango (1 a 17).\n";
+        return -1;
+    }
+    precision_ = precision;
+    return 1;
+}
+
+/* writes the buffered rows to the file (to the writer thread in async mode) */
+void Writer::flush() {
+    if (!is_open_ || buffer_.empty()) return;
+    if (async_) {
+        async_->write(buffer_.data(), buffer_.size());
+    } else {
+        file_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+    }
+    buffer_.clear();
+}
+
+/* appends one value of a typed row to the buffer */
+template<typename T>
+void Writer::append_field(const T& value) {
+    char text[64];
+    if constexpr (std::is_same<T, bool>::value) {
+        buffer_ += value ? '1' : '0';
+    } else if constexpr (std::is_same<T, char>::value) {
+        buffer_ += value;
+    } else if constexpr (std::is_integral<T>::value) {
+        buffer_.append(text, std::to_chars(text, text + sizeof(text), value).ptr);
+    } else if constexpr (std::is_floating_point<T>::value) {
+        buffer_.append(text, std::to_chars(text, text + sizeof(text), static_cast<double>(value),
+                                           std::chars_format::general, precision_).ptr);
+    } else {
+        buffer_ += value;
+    }
+}
+
+/*
+    ends the row in the buffer and writes the buffer once it holds kFlushSize bytes
+    in async mode each row goes to the writer thread, which already groups them in blocks
+*/
+void Writer::end_row() {
+    buffer_ += '\n';
+    if (async_ || buffer_.size() >= kFlushSize) flush();
+}
+
+/*
+    moves the file I/O to a background thread: rows are copied into blocks of block_size bytes and a writer thread
+    stores the full ones, policy says what happens to a row when every block is waiting for the disk (AsyncWriter::Policy)
+    obs: rows must be written from a single thread, returns -1 if the file is not open or async mode is already on
+*/
+int Writer::enableAsync(size_t block_size, size_t num_blocks, AsyncWriter::Policy policy) {
+    if (!is_open_ || async_) {
+        std::cerr << "Error: No se puede activar la escritura asincrona.\n";
+        return -1;
+    }
+    flush();
+    file_.close();
+    async_.reset(new AsyncWriter(file_name_, block_size, num_blocks, policy, 256, true));
+    return 1;
+}
+
+/* returns the number of bytes the writer thread stored, 0 if async mode is off */
+uint64_t Writer::getBytesWritten() {
+    return async_ ? async_->getBytesWritten() : 0;
+}
+
+/* returns the number of rows discarded by the async mode (AsyncWriter::DROP and GROW policies, rows longer than a block) */
+uint64_t Writer::getRowsDropped() {
+    return async_ ? async_->getRecordsDropped() : 0;
 }
 
 /* Cierra el archivo si está abierto */
 void Writer::close() {
     if (is_open_) {
-        file_.close();
+        flush();
+        if (async_) {
+            async_->close();
+        } else {
+            file_.close();
+        }
         is_open_ = false;
     }
 }
@@ -1,11 +1,18 @@
-#include <unistd.h>
+#include <cerrno>
+#include <ctime>
 
 namespace pimu {
 
-/* stops the program execution for a duration in miliseconds */
+/* stops the program execution for a duration in miliseconds, sleeps to an absolute deadline so interruptions don't add up */
 void delay(int duration_miliseconds){
-    while(duration_miliseconds--){
-        usleep(1000);
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += duration_miliseconds / 1000;
+    deadline.tv_nsec += (duration_miliseconds % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
     }
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR) {}
 }
-} // namespace pimu
\ No newline at end of file
+} // namespace pimu
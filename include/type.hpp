@@ -1,3 +1,5 @@
+#include <cstdint>
+
 namespace pimu
 {
 
@@ -18,4 +20,42 @@ struct MultiSensor
     float ax, ay, az;
 };
 
+/* raw MPU9250 read, counts as they come from the registers (accel and gyro before the axis transformation) */
+struct SensorFrame
+{
+    /* CLOCK_MONOTONIC time the bus read finished [ns] */
+    int64_t timestamp_ns;
+
+    /* bus read counter of the module, increases by one per read */
+    uint64_t seq;
+
+    /* accel, temperature, gyro and magnetometer counts */
+    int16_t ax, ay, az;
+    int16_t temp;
+    int16_t gx, gy, gz;
+    int16_t hx, hy, hz;
+};
+
+/* sample produced by the Imu update thread */
+struct ImuSample
+{
+    /* update counter, increases by one per sample */
+    uint64_t seq;
+
+    /* CLOCK_MONOTONIC time of the sensor read [ns] */
+    int64_t timestamp_ns;
+
+    /* gyro data with filters and bias applied, not rounded [rad/s] */
+    Sensor gyro;
+
+    /* accel specific force, gravity included [G] */
+    Sensor accel;
+
+    /* accel with gravity removed [G] */
+    Sensor linear_accel;
+
+    /* X and Y axis angles [sexagesimal degree] */
+    float x_axis_angle, y_axis_angle;
+};
+
 }// namespace pimu
\ No newline at end of file
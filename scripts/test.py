@@ -32,7 +32,7 @@ def merge_files(cpp_file, hpp_file, output_folder):
     
     # Create Makefile
     makefile_content = f"""all:
-	g++ {cpp_filename} -o {cpp_base_name}  
+	g++ -std=gnu++17 -pthread {cpp_filename} -o {cpp_base_name}  
 	./{cpp_base_name}
 """
     
@@ -0,0 +1,59 @@
+#include "pimu.hpp" // python3 ../scripts/merge.py ../include .hpp pimu.hpp
+
+#include <cstdlib>
+#include <cstdio>
+
+/*
+    gyro noise characterization
+    usage: ./allan <seconds> <file.bin>   records raw gyro [rad/s] and analyzes it
+           ./allan 0 <file.bin>           analyzes an existing recording
+    the recording is raw float32, 3 interleaved channels (x, y, z)
+*/
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        std::cout << "Uso: " << argv[0] << " <segundos> <archivo.bin>\n";
+        return 1;
+    }
+
+    int duration_seconds = atoi(argv[1]);
+    const float sample_rate = 1000.0f;
+
+    if (duration_seconds > 0) {
+        pimu::MPU9250 mpu;
+        mpu.begin();
+        mpu.setSrd(0); // 1 kHz internal sample rate
+
+        FILE *file = fopen(argv[2], "wb");
+        if (file == nullptr) {
+            std::cerr << "Error: No se pudo abrir el archivo " << argv[2] << "\n";
+            return 1;
+        }
+
+        std::cout << "Grabando " << duration_seconds << " segundos. NO MUEVA EL Sensor.\n";
+        auto period = std::chrono::microseconds(static_cast<int>(1e6f / sample_rate));
+        auto next = std::chrono::steady_clock::now();
+        auto end = next + std::chrono::seconds(duration_seconds);
+        while (next < end) {
+            mpu.readSensor(true); // every period is a new bus read, no frame reuse
+            float sample[3] = {mpu.getGyroX_rads(), mpu.getGyroY_rads(), mpu.getGyroZ_rads()};
+            fwrite(sample, sizeof(float), 3, file);
+            next += period;
+            std::this_thread::sleep_until(next);
+        }
+        fclose(file);
+    }
+
+    pimu::Allan allan(sample_rate);
+    std::vector<pimu::AllanPoint> points = allan.computeFile(argv[2], 3);
+    if (points.empty()) return 1;
+
+    std::cout << "tau [s], adev x, adev y, adev z [rad/s]\n";
+    pimu::Allan::print(points);
+
+    const char *axis[3] = {"x", "y", "z"};
+    for (int c = 0; c < 3; c++) {
+        std::cout << axis[c] << ": ARW " << pimu::Allan::angleRandomWalk(points, c) << " rad/sqrt(s), "
+                  << "bias instability " << pimu::Allan::biasInstability(points, c) << " rad/s\n";
+    }
+    return 0;
+}
@@ -0,0 +1,86 @@
+#include "pimu.hpp" // python3 ../scripts/merge.py ../include .hpp pimu.hpp
+
+#include <cmath>
+#include <cstdlib>
+#include <random>
+
+/*
+    compression ratio and speed of the sample codec
+    usage: ./codec_bench [binary log | -] [block samples]
+    obs: without a log (see Imu::enableBinaryLog) or with - it uses 60 s of synthetic 1 kHz data, a still sensor with noise and drift
+*/
+static std::vector<int16_t> synthetic(size_t num_samples) {
+    std::mt19937 generator(1);
+    std::normal_distribution<float> noise(0.0f, 1.0f);
+    const float kBase[pimu::kLogChannels] = {120, -340, 16384, 2900, 14, -22, 5, 110, -60, 240};
+    const float kNoise[pimu::kLogChannels] = {18, 18, 25, 3, 4, 4, 4, 6, 6, 6};
+    std::vector<int16_t> samples(num_samples * pimu::kLogChannels);
+    float drift[pimu::kLogChannels] = {};
+    for (size_t i = 0; i < num_samples; i++) {
+        for (int c = 0; c < pimu::kLogChannels; c++) {
+            drift[c] += 0.05f * noise(generator);
+            float motion = 400.0f * std::sin(2.0f * float(M_PI) * 0.5f * i / 1000.0f);
+            samples[i * pimu::kLogChannels + c] = int16_t(kBase[c] + drift[c] + motion + kNoise[c] * noise(generator));
+        }
+    }
+    return samples;
+}
+
+int main(int argc, char **argv) {
+    int block_samples = argc > 2 ? atoi(argv[2]) : 256;
+    std::vector<int16_t> samples;
+    if (argc > 1 && std::string(argv[1]) != "-") {
+        try {
+            pimu::BinaryLogReader log(argv[1]);
+            for (uint64_t i = 0; i < log.getRecordCount(); i++) {
+                const pimu::BinaryLogRecord &record = log.getRecord(i);
+                samples.insert(samples.end(), record.raw, record.raw + pimu::kLogChannels);
+            }
+        } catch (const std::exception &e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            return 1;
+        }
+    } else {
+        samples = synthetic(60000);
+    }
+    size_t num_samples = samples.size() / pimu::kLogChannels;
+    if (num_samples == 0) {
+        std::cerr << "Error: El registro no tiene muestras.\n";
+        return 1;
+    }
+
+    pimu::SampleEncoder encoder(pimu::kLogChannels, block_samples);
+    std::vector<uint8_t> stream;
+    uint64_t start = pimu::LoopProfiler::now();
+    for (size_t i = 0; i < num_samples; i++) {
+        if (encoder.push(&samples[i * pimu::kLogChannels])) {
+            stream.insert(stream.end(), encoder.getBlock().begin(), encoder.getBlock().end());
+        }
+    }
+    if (encoder.flush()) stream.insert(stream.end(), encoder.getBlock().begin(), encoder.getBlock().end());
+    uint64_t encode_ns = pimu::LoopProfiler::now() - start;
+
+    pimu::SampleDecoder decoder;
+    std::vector<int16_t> decoded, block;
+    start = pimu::LoopProfiler::now();
+    for (size_t offset = 0; offset < stream.size();) {
+        size_t size = decoder.decode(stream.data() + offset, stream.size() - offset, block);
+        if (size == 0) {
+            std::cerr << "Error: Bloque invalido en el byte " << offset << "\n";
+            return 1;
+        }
+        decoded.insert(decoded.end(), block.begin(), block.end());
+        offset += size;
+    }
+    uint64_t decode_ns = pimu::LoopProfiler::now() - start;
+
+    bool lossless = decoded == samples;
+    std::cout << "Muestras: " << num_samples << " x " << pimu::kLogChannels << " canales, bloques de " << block_samples << "\n";
+    std::cout << "Original: " << encoder.getInputBytes() << " B, comprimido: " << encoder.getOutputBytes() << " B\n";
+    std::cout << "Razon de compresion: " << double(encoder.getInputBytes()) / encoder.getOutputBytes() << "\n";
+    std::cout << "Bits por valor: " << 8.0 * encoder.getOutputBytes() / samples.size() << "\n";
+    std::cout << "Codificacion: " << double(encode_ns) / num_samples << " ns/muestra\n";
+    std::cout << "Decodificacion: " << double(decode_ns) / num_samples << " ns/muestra\n";
+    std::cout << "Sin perdidas: " << (lossless ? "si" : "no") << "\n";
+    return lossless ? 0 : 1;
+}
@@ -0,0 +1,42 @@
+#include "pimu.hpp" // python3 ../scripts/merge.py ../include .hpp pimu.hpp
+
+#include <cstdlib>
+
+/*
+    update thread wakeup jitter, with the default scheduler and with the realtime options
+    usage: ./jitter <seconds> [priority] [cpu]
+    obs: SCHED_FIFO and mlockall need root (or CAP_SYS_NICE / CAP_IPC_LOCK), without them only the pinning applies
+*/
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::cout << "Uso: " << argv[0] << " <segundos> [prioridad] [cpu]\n";
+        return 1;
+    }
+
+    int duration_seconds = atoi(argv[1]);
+    pimu::RealtimeOptions options;
+    options.priority = argc > 2 ? atoi(argv[2]) : 80;
+    options.cpu = argc > 3 ? atoi(argv[3]) : 3;
+    options.lock_memory = true;
+    options.prefault_stack_bytes = 256 * 1024;
+
+    pimu::MPU9250 mpu;
+    pimu::Imu imu(mpu);
+    imu.begin();
+    imu.setUpdateRate(1000.0f);
+
+    std::cout << "Planificador por defecto:\n";
+    imu.startUpdateThread();
+    std::this_thread::sleep_for(std::chrono::seconds(duration_seconds));
+    imu.stopUpdateThread();
+    pimu::JitterMeter::print(imu.getJitterReport());
+
+    std::cout << "SCHED_FIFO " << options.priority << ", cpu " << options.cpu << ", mlockall:\n";
+    imu.setRealtimeOptions(options);
+    imu.startUpdateThread();
+    std::this_thread::sleep_for(std::chrono::seconds(duration_seconds));
+    imu.stopUpdateThread();
+    pimu::JitterMeter::print(imu.getJitterReport());
+
+    return 0;
+}